@@ -0,0 +1,255 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
+#include "../utils/parallel.h"
+
+using namespace std;
+
+/*
+@brief timings of one benchmark in nanoseconds, flops and bytes are per call (0 if not meaningful)
+*/
+struct BenchResult {
+    string name;
+    string size;
+    int threads = 1;
+    int samples = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double median = 0.0;
+    double flops = 0.0;
+    double bytes = 0.0;
+
+    /*
+    @brief unique key of the benchmark used to compare against a baseline
+    */
+    string key() const {
+        return name + "/" + size + "/" + to_string(threads);
+    }
+};
+
+/*
+@brief small benchmark harness that runs warm-up calls, measures a fixed amount of samples and collects the results
+@param warmup amount of calls that are run before measuring and discarded (default is 2)
+@param samples amount of measured calls (default is 10)
+*/
+struct Bench {
+    int warmup = 2;
+    int samples = 10;
+    double timerOverhead = 0.0;
+    vector<BenchResult> results;
+
+    Bench(int warmup = 2, int samples = 10) : warmup(warmup), samples(samples) {
+        //smallest time between two clock reads is subtracted from every sample
+        timerOverhead = 1e18;
+        for(int i = 0; i<1000; i++){
+            auto start = chrono::steady_clock::now();
+            auto end = chrono::steady_clock::now();
+            timerOverhead = std::min(timerOverhead, double(chrono::duration_cast<chrono::nanoseconds>(end - start).count()));
+        }
+    }
+
+    /*
+    @brief benchmark a function
+    @param name name of the benchmark
+    @param size description of the problem size
+    @param f function to call
+    @param flops floating point operations per call (0 if not meaningful)
+    @param bytes bytes read and written per call (0 if not meaningful)
+    @param threads amount of OpenMP threads to use (all by default)
+    @returns the measured result
+    */
+    template<typename F>
+    BenchResult run(const string& name, const string& size, F f, double flops = 0.0, double bytes = 0.0, int threads = 0){
+        int previousThreads = omp_get_max_threads();
+        if(threads > 0){
+            omp_set_num_threads(threads);
+            Parallel::configure(threads);
+        }
+
+        for(int i = 0; i<warmup; i++){
+            f();
+        }
+
+        vector<double> times;
+        for(int i = 0; i<samples; i++){
+            auto start = chrono::steady_clock::now();
+            f();
+            auto end = chrono::steady_clock::now();
+            double elapsed = double(chrono::duration_cast<chrono::nanoseconds>(end - start).count()) - timerOverhead;
+            times.push_back(std::max(elapsed, 0.0));
+        }
+
+        BenchResult result;
+        result.name = name;
+        result.size = size;
+        result.threads = omp_get_max_threads();
+        result.samples = samples;
+        result.flops = flops;
+        result.bytes = bytes;
+
+        for(double t : times){
+            result.mean += t;
+        }
+        result.mean /= samples;
+
+        for(double t : times){
+            result.stddev += (t - result.mean) * (t - result.mean);
+        }
+        result.stddev = (samples > 1) ? sqrt(result.stddev / (samples - 1)) : 0.0;
+
+        sort(times.begin(), times.end());
+        result.min = times.front();
+        result.median = times[samples / 2];
+
+        if(threads > 0){
+            omp_set_num_threads(previousThreads);
+            Parallel::configure(previousThreads);
+        }
+
+        print(result);
+        results.push_back(result);
+        return result;
+    }
+
+    /*
+    @brief benchmark a function for 1, 2, 4, ... up to the maximum amount of threads and print the speedup over one thread
+    @param name name of the benchmark
+    @param size description of the problem size
+    @param f function to call
+    @param flops floating point operations per call (0 if not meaningful)
+    @param bytes bytes read and written per call (0 if not meaningful)
+    */
+    template<typename F>
+    void scaling(const string& name, const string& size, F f, double flops = 0.0, double bytes = 0.0){
+        int maxThreads = omp_get_max_threads();
+        double single = 0.0;
+
+        for(int threads = 1; ; threads *= 2){
+            threads = std::min(threads, maxThreads);
+            auto result = run(name, size, f, flops, bytes, threads);
+
+            if(threads == 1){
+                single = result.median;
+            }
+            cout << "    speedup over 1 thread: " << fixed << setprecision(2) << single / result.median << endl;
+
+            if(threads == maxThreads){
+                break;
+            }
+        }
+    }
+
+    /*
+    @brief print one result
+    */
+    static void print(const BenchResult& result){
+        cout << left << setw(20) << result.name << setw(18) << result.size << right << setw(4) << result.threads << "t"
+             << fixed << setprecision(3)
+             << setw(14) << result.median / 1e6 << " ms"
+             << " +- " << setw(9) << result.stddev / 1e6 << " ms";
+
+        if(result.flops > 0){
+            cout << setw(10) << result.flops / result.median << " GFLOP/s";
+        }
+        if(result.bytes > 0){
+            cout << setw(10) << result.bytes / result.median << " GB/s";
+        }
+        cout << endl;
+    }
+
+    /*
+    @brief write all results as JSON with one result per line so that runs can be diffed
+    @param path path of the output file
+    */
+    void writeJSON(const string& path){
+        ofstream out(path);
+        out << "{\n  \"max_threads\": " << omp_get_max_threads() << ",\n  \"results\": [\n";
+
+        for(int i = 0; i<results.size(); i++){
+            const auto& r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"size\": \"" << r.size << "\", \"threads\": " << r.threads
+                << ", \"samples\": " << r.samples << setprecision(1) << fixed
+                << ", \"mean_ns\": " << r.mean << ", \"stddev_ns\": " << r.stddev << ", \"min_ns\": " << r.min
+                << ", \"median_ns\": " << r.median << setprecision(4)
+                << ", \"gflops\": " << ((r.flops > 0) ? r.flops / r.median : 0.0)
+                << ", \"gbytes_per_s\": " << ((r.bytes > 0) ? r.bytes / r.median : 0.0) << "}"
+                << ((i + 1 < results.size()) ? "," : "") << "\n";
+        }
+
+        out << "  ]\n}\n";
+    }
+
+    /*
+    @brief read the median timings of a JSON file written by writeJSON
+    @param path path of the baseline file
+    @returns map from benchmark key to median time in nanoseconds
+    */
+    static map<string, double> readBaseline(const string& path){
+        map<string, double> baseline;
+        ifstream in(path);
+        string line;
+
+        auto field = [](const string& line, const string& name){
+            size_t start = line.find("\"" + name + "\": ");
+            if(start == string::npos){
+                return string();
+            }
+            start += name.size() + 4;
+            if(line[start] == '"'){
+                start++;
+                return line.substr(start, line.find('"', start) - start);
+            }
+            return line.substr(start, line.find_first_of(",}", start) - start);
+        };
+
+        while(getline(in, line)){
+            if(line.find("\"name\"") == string::npos){
+                continue;
+            }
+            string key = field(line, "name") + "/" + field(line, "size") + "/" + field(line, "threads");
+            baseline[key] = stod(field(line, "median_ns"));
+        }
+
+        return baseline;
+    }
+
+    /*
+    @brief print the change of every result against a baseline file written by an earlier run
+    @param path path of the baseline file
+    */
+    void compare(const string& path){
+        auto baseline = readBaseline(path);
+
+        cout << "===== Comparison against " << path << " =====" << endl;
+        for(const auto& result : results){
+            auto found = baseline.find(result.key());
+            if(found == baseline.end()){
+                cout << left << setw(44) << result.key() << right << "       new" << endl;
+                continue;
+            }
+            double change = (result.median - found->second) / found->second * 100.0;
+            cout << left << setw(44) << result.key() << right << fixed << setprecision(1) << setw(9) << change << "%" << endl;
+        }
+    }
+};
+
+/*
+@brief prevent the compiler from optimising away a benchmarked result
+@param value value to keep
+*/
+template<typename T>
+void keep(const T& value){
+    volatile T sink = value;
+    (void)sink;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "bench.h"
+#include "bench_matrix.h"
+#include "../utils/gallery.h"
+#include "../utils/ivfpq.h"
+#include <random>
+#include <iomanip>
+#include <string>
+
+using namespace std;
+
+/*
+@brief search a large gallery of projected faces with the shards on one node, on a simulated two node split of the
+local CPUs and on the nodes of the machine
+@param bench the harness to collect the results in
+*/
+void GalleryBenchmarks(Bench& bench){
+
+    cout << "===== Gallery Benchmarks =====" << endl;
+
+    const int faces = 50000;
+    const int k = 50;
+    const int probes = 64;
+    const int top = 10;
+
+    auto gallery = randomMatrix(faces, k, 11);
+    auto probeWeights = randomMatrix(probes, k, 12);
+
+    auto detected = NumaTopology::detect();
+    vector<pair<string, NumaTopology>> layouts = {
+        make_pair(string("single"), NumaTopology::single()),
+        make_pair(string("split2"), NumaTopology::split(2)),
+        make_pair("numa" + to_string(detected.nodes.size()), detected)
+    };
+
+    for(const auto& layout : layouts){
+        ShardedGallery sharded(gallery, layout.second);
+        bench.run("gallery/" + layout.first, dims(faces, k) + "/" + to_string(sharded.shards.size()) + "shards", [&](){
+            keep(sharded.search(probeWeights, top)[0][0].distance);
+        }, 3.0 * faces * k * probes, sizeof(float) * double(faces) * k);
+    }
+}
+
+/*
+@brief compare the IVF-PQ index with the exact scan of the float gallery for several nprobe: memory per face, queries
+per second and recall@1 (the exact nearest face is the first match of the index). The faces are drawn around subject
+centers like the projections of several images per subject
+@param bench the harness to collect the results in
+*/
+void IndexBenchmarks(Bench& bench){
+
+    cout << "===== IVF-PQ Index Benchmarks =====" << endl;
+
+    const int subjects = 10000;
+    const int perSubject = 10;
+    const int faces = subjects * perSubject;
+    const int k = 48;
+    const int probes = 200;
+    const int lists = 256;
+    const int subspaces = 24;
+
+    mt19937 generator(21);
+    normal_distribution<float> center(0.0, 10.0);
+    normal_distribution<float> noise(0.0, 3.0);
+    Matrix<float> centers(subjects, k);
+    for(int i = 0; i<subjects * k; i++){
+        centers[i] = center(generator);
+    }
+    Matrix<float> gallery(faces, k);
+    for(int i = 0; i<faces; i++){
+        for(int c = 0; c<k; c++){
+            gallery(i, c) = centers(i % subjects, c) + noise(generator);
+        }
+    }
+    Matrix<float> probeWeights(probes, k);
+    for(int q = 0; q<probes; q++){
+        for(int c = 0; c<k; c++){
+            probeWeights(q, c) = centers((q * 37) % subjects, c) + noise(generator);
+        }
+    }
+
+    ShardedGallery exact(gallery, NumaTopology::single());
+    auto truth = exact.search(probeWeights, 1);
+    auto scan = bench.run("index/exact", dims(faces, k), [&](){
+        keep(exact.search(probeWeights, 1)[0][0].distance);
+    }, 3.0 * faces * k * probes, sizeof(float) * double(faces) * k);
+    cout << "    " << sizeof(float) * k << " bytes/face, " << fixed << setprecision(0) << probes / (scan.median * 1e-9)
+         << " queries/s" << endl;
+
+    IVFPQIndex index(k, lists, subspaces);
+    {
+        //the centroids are learned from a sample of the gallery
+        Matrix<float> sample(faces / 5, k);
+        copy(gallery.data.get(), gallery.data.get() + size_t(sample.M) * k, sample.data.get());
+        index.train(sample, 10);
+    }
+    index.add(gallery);
+
+    for(int nprobe : {1, 4, 16, 64}){
+        auto result = bench.run("index/ivfpq", dims(faces, k) + "/nprobe" + to_string(nprobe), [&](){
+            keep(index.search(probeWeights, 1, nprobe)[0][0].distance);
+        });
+
+        //recall@1 and @10 of the exact nearest face, and how often the first match is a face of the probe's subject
+        auto matches = index.search(probeWeights, 10, nprobe);
+        int first = 0;
+        int top = 0;
+        int subject = 0;
+        for(int q = 0; q<probes; q++){
+            first += (matches[q][0].index == truth[q][0].index);
+            subject += (matches[q][0].index % subjects == (q * 37) % subjects);
+            for(const auto& match : matches[q]){
+                top += (match.index == truth[q][0].index);
+            }
+        }
+        cout << "    " << fixed << setprecision(1) << double(index.bytes()) / faces << " bytes/face, " << setprecision(0)
+             << probes / (result.median * 1e-9) << " queries/s, recall@1 " << setprecision(3) << double(first) / probes
+             << ", recall@10 " << double(top) / probes << ", same subject " << double(subject) / probes << endl;
+    }
+}
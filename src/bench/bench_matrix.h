@@ -0,0 +1,183 @@
+#pragma once
+
+#include "bench.h"
+#include "../utils/matrix.h"
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+#include <tuple>
+
+using namespace std;
+
+/*
+@brief create a matrix filled with reproducible random values
+@param M number of rows
+@param N number of columns
+@param seed seed of the random generator
+@returns Matrix<float> with values between -1 and 1
+*/
+Matrix<float> randomMatrix(int M, int N, int seed = 42){
+    mt19937 generator(seed);
+    uniform_real_distribution<float> distribution(-1.0, 1.0);
+
+    Matrix<float> result(M, N);
+    for(int i = 0; i<M*N; i++){
+        result[i] = distribution(generator);
+    }
+    return result;
+}
+
+/*
+@brief create a random symmetric positive semi-definite matrix (B^T*B) like a covariance or Gram matrix
+@param N number of rows and columns
+@returns Matrix<float> of size N by N
+*/
+Matrix<float> randomSymmetric(int N){
+    auto B = randomMatrix(N, N, 7);
+    return Matrix<float>::multMat(B.transpose(), B) / float(N);
+}
+
+string dims(int a, int b){
+    return to_string(a) + "x" + to_string(b);
+}
+
+string dims(int a, int b, int c){
+    return to_string(a) + "x" + to_string(b) + "x" + to_string(c);
+}
+
+/*
+@brief benchmarks of the Matrix kernels at the sizes that occur when training on the ORL faces
+(1400 pixels per face after pooling the 80 by 70 images by 2, 205 training faces)
+@param bench the harness to collect the results in
+*/
+void MatrixBenchmarks(Bench& bench){
+
+    cout << "===== Matrix Benchmarks =====" << endl;
+
+    const int pixels = 1400;
+    const int faces = 205;
+    const double f = sizeof(float);
+
+    //face matrix A and its transpose as used for the Gram and covariance products
+    auto A = randomMatrix(pixels, faces);
+    auto AT = A.transpose();
+
+    bench.scaling("multMat", dims(faces, pixels, faces), [&](){
+        keep(Matrix<float>::multMat(AT, A)[0]);
+    }, 2.0 * faces * pixels * faces, f * (2.0 * faces * pixels + faces * faces));
+
+    //the covariance product as Train computes it, with a column-major face matrix
+    auto ACol = A.reorder<ColMajor>();
+    auto ATCol = AT.reorder<ColMajor>();
+    bench.scaling("multMat/col", dims(pixels, faces, pixels), [&](){
+        keep(Matrix<float, ColMajor>::multMat(ACol, ATCol)[0]);
+    }, 2.0 * pixels * faces * pixels, f * (2.0 * faces * pixels + pixels * pixels));
+
+    //same product with A^T read through a transposed view instead of a copy
+    bench.scaling("multMat/col view", dims(pixels, faces, pixels), [&](){
+        keep(Matrix<float, ColMajor>::multMat(ACol, ACol.transposedView())[0]);
+    }, 2.0 * pixels * faces * pixels, f * (faces * pixels + pixels * pixels));
+
+    bench.scaling("transpose", dims(pixels, faces), [&](){
+        keep(A.transpose()[0]);
+    }, 0.0, f * 2.0 * pixels * faces);
+
+    auto square = randomMatrix(pixels, pixels, 3);
+    bench.scaling("transposeInPlace", dims(pixels, pixels), [&](){
+        square.transposeInPlace();
+        keep(square[1]);
+    }, 0.0, f * 2.0 * pixels * pixels);
+
+    //elementwise ops on a whole face matrix and on a single face vector (serial below the grain)
+    bench.scaling("add", dims(pixels, faces), [&](){
+        keep(Matrix<float>::add(A, A)[0]);
+    }, 1.0 * pixels * faces, f * 3.0 * pixels * faces);
+
+    auto column = A.getColumn(0);
+    bench.scaling("add", dims(pixels, 1), [&](){
+        keep(Matrix<float>::add(column, column)[0]);
+    }, 1.0 * pixels, f * 3.0 * pixels);
+
+    //eigensolver building blocks on a Gram sized symmetric matrix
+    const int n = faces;
+    auto S = randomSymmetric(n);
+
+    bench.run("GramSchmidt", dims(n, n), [&](){
+        keep(S.GramSchmidt()[0]);
+    }, 2.0 * n * n * n);
+
+    auto SCol = S.reorder<ColMajor>();
+    bench.run("GramSchmidt/col", dims(n, n), [&](){
+        keep(SCol.GramSchmidt()[0]);
+    }, 2.0 * n * n * n);
+
+    bench.run("QRDecomposition", dims(n, n), [&](){
+        keep(get<0>(S.QRDecomposition())[0]);
+    }, 4.0 * n * n * n);
+
+    const int iterations = 5;
+    bench.run("eigen", dims(n, n) + "/" + to_string(iterations) + "it", [&](){
+        keep(get<1>(S.eigen(iterations))[0]);
+    }, iterations * 8.0 * n * n * n);
+
+    //reductions over a face vector and the whole face matrix
+    auto face = A.getColumn(0);
+    auto other = A.getColumn(1);
+
+    bench.run("norm", dims(pixels, 1), [&](){
+        keep(face.norm());
+    }, 2.0 * pixels, f * pixels);
+
+    bench.run("norm", dims(pixels, faces), [&](){
+        keep(A.norm());
+    }, 2.0 * pixels * faces, f * pixels * faces);
+
+    bench.run("L2", dims(pixels, 1), [&](){
+        keep(Matrix<float>::L2(face, other));
+    }, 3.0 * pixels, f * 2.0 * pixels);
+
+    bench.run("L2", dims(pixels, faces), [&](){
+        keep(Matrix<float>::L2(A, A));
+    }, 3.0 * pixels * faces, f * 2.0 * pixels * faces);
+}
+
+/*
+@brief compare the external BLAS/LAPACK backend with the built-in kernels at the Train sizes, only runs in builds with
+the backend (cmake -DUSE_BLAS=ON)
+@param bench the harness to collect the results in
+*/
+void BackendBenchmarks(Bench& bench){
+
+    cout << "===== Backend Benchmarks =====" << endl;
+    if(!Backend::compiled()){
+        cout << "built without USE_BLAS, skipped" << endl;
+        return;
+    }
+
+    const int pixels = 1400;
+    const int faces = 205;
+    const int iterations = 20;
+
+    auto A = randomMatrix(pixels, faces).reorder<ColMajor>();
+    auto S = randomSymmetric(faces).reorder<ColMajor>();
+
+    //the native eigen runs a fixed amount of QR iterations (Train uses many more), the backend solves directly
+    vector<tuple<string, string, function<void()>>> kernels = {
+        make_tuple("covariance", dims(pixels, faces), [&](){ keep(Matrix<float, ColMajor>::multTransposed(A)[0]); }),
+        make_tuple("multMat", dims(faces, pixels, faces), [&](){ keep(Matrix<float, ColMajor>::multMat(A.transposedView(), A)[0]); }),
+        make_tuple("QRDecomposition", dims(faces, faces), [&](){ keep(get<0>(S.QRDecomposition())[0]); }),
+        make_tuple("eigen", dims(faces, faces), [&](){ keep(get<1>(S.eigen(iterations))[0]); })
+    };
+
+    bool previous = Backend::enabled();
+    for(auto& kernel : kernels){
+        Backend::enabled() = false;
+        auto native = bench.run(get<0>(kernel), get<1>(kernel) + "/native", get<2>(kernel));
+        Backend::enabled() = true;
+        auto external = bench.run(get<0>(kernel), get<1>(kernel) + "/blas", get<2>(kernel));
+
+        cout << "    blas speedup over native: " << fixed << setprecision(2) << native.median / external.median << endl;
+    }
+    Backend::enabled() = previous;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "bench.h"
+#include "../utils/image.h"
+#include "../utils/pca.h"
+#include "../utils/face.h"
+#include "../utils/cascade.h"
+#include "../utils/dataset.h"
+#include "bench_matrix.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+/*
+@brief benchmarks of loading the ORL faces and training on them
+@param bench the harness to collect the results in
+*/
+void PcaBenchmarks(Bench& bench){
+
+    cout << "===== PCA Benchmarks =====" << endl;
+
+    const char* path = "../images/archive/1_1.jpg";
+
+    for(int poolingFactor : {1, 2, 4, 8}){
+        bench.run("Image", "pool" + to_string(poolingFactor), [&](){
+            auto image = Image(path, poolingFactor);
+            keep(image.data->M);
+        });
+    }
+
+    bench.scaling("createData", "410/pool2", [&](){
+        auto data = createData(0.5, 2);
+        keep(get<0>(data).size());
+    });
+
+    //every pooling factor with the JPEG decoder scaling the image and with a full decode followed by INTER_AREA
+    auto datasetPaths = imagePaths();
+    for(int poolingFactor : {1, 2, 4, 8}){
+        for(bool reduced : {false, true}){
+            bench.run(reduced ? "load/reduced" : "load/full", to_string(datasetPaths.size()) + "/pool" + to_string(poolingFactor), [&](){
+                for(const auto& path : datasetPaths){
+                    keep(Image(path.c_str(), poolingFactor, reduced).data->M);
+                }
+            });
+        }
+    }
+
+    //only the training faces are decoded and they stay within the budget of the cache
+    bench.run("LazyDataset", "205/pool2/train", [&](){
+        LazyDataset dataset(2);
+        auto trainData = dataset.load(get<0>(dataset.split(0.5)));
+        keep(trainData.size());
+    });
+
+    //per face kernels for the 40 by 35 geometry with the compile-time extent and with the dynamic one
+    auto faces = get<0>(createData(0.5, 2));
+    auto mean = meanFace(faces);
+    auto basis = randomMatrix(mean.M, 50).reorder<ColMajor>();
+    vector<float> centered(mean.M);
+    vector<float> weights(50);
+
+    auto fixedKernels = faceKernels(40, 35);
+    auto dynamicKernels = makeFaceKernelTable<0>(40, 35);
+    for(auto kernels : {fixedKernels, dynamicKernels}){
+        string geometry = string("40x35/") + (kernels.fixed ? "fixed" : "dynamic");
+
+        bench.run("center", geometry, [&](){
+            for(const auto& face : faces){
+                kernels.center(face.data->data.get(), mean.data.get(), centered.data(), kernels.pixels);
+            }
+            keep(centered[0]);
+        }, 1.0 * faces.size() * mean.M, sizeof(float) * 3.0 * faces.size() * mean.M);
+
+        bench.run("project", geometry + "/k50", [&](){
+            for(int i = 0; i<faces.size(); i++){
+                kernels.project(centered.data(), basis.data.get(), 50, weights.data(), kernels.pixels);
+            }
+            keep(weights[0]);
+        }, 2.0 * faces.size() * mean.M * 50);
+    }
+
+    //probe ingestion: the 8-bit pixels converted to a float face, centered into a second buffer and projected, against
+    //the fused kernel that widens and centers blocks on the fly for batches of probes that share the blocks of the basis.
+    //The kernel shares a block between at most FaceKernels::ProbeBatch (4) probes, so larger batches are not measured.
+    //The 40 by 35 basis with k = 50 fits into L2, the 112 by 92 basis with k = 100 (4 MB) has to come from memory
+    auto ingest = [&](int rows, int cols, int k, int probes){
+        int pixels = rows * cols;
+        auto kernels = faceKernels(rows, cols);
+        auto probeMean = randomMatrix(pixels, 1, 41) * 100.0f;
+        auto probeBasis = randomMatrix(pixels, k, 42).reorder<ColMajor>();
+
+        vector<vector<uint8_t>> probeBytes(probes, vector<uint8_t>(pixels));
+        vector<const uint8_t*> probePointers;
+        for(int f = 0; f<probes; f++){
+            for(int i = 0; i<pixels; i++){
+                probeBytes[f][i] = uint8_t((i * 13 + f * 101) % 256);
+            }
+            probePointers.push_back(probeBytes[f].data());
+        }
+
+        string size = dims(rows, cols) + "/k" + to_string(k);
+        double flops = 2.0 * probes * pixels * k;
+        double basisBytes = sizeof(float) * double(pixels) * k * probes;
+        vector<float> probeWeights(probes * k);
+
+        bench.run("ingest/float", size, [&](){
+            for(int f = 0; f<probes; f++){
+                Matrix<float> face(rows, cols);
+                copy(probeBytes[f].begin(), probeBytes[f].end(), face.data.get());
+                vector<float> faceCentered(pixels);
+                kernels.center(face.data.get(), probeMean.data.get(), faceCentered.data(), pixels);
+                kernels.project(faceCentered.data(), probeBasis.data.get(), k, probeWeights.data() + f * k, pixels);
+            }
+            keep(probeWeights[0]);
+        }, flops, basisBytes);
+
+        for(int batch : {1, 4}){
+            bench.run("ingest/fused", size + "/batch" + to_string(batch), [&](){
+                for(int first = 0; first<probes; first += batch){
+                    kernels.projectBytes(probePointers.data() + first, min(batch, probes - first), probeMean.data.get(),
+                                         probeBasis.data.get(), k, probeWeights.data() + first * k, pixels);
+                }
+                keep(probeWeights[0]);
+            }, flops, basisBytes);
+        }
+    };
+    ingest(40, 35, 50, 205);
+    ingest(112, 92, 100, 64);
+
+    //covariance of the training set accumulated by worker processes (decode included)
+    auto paths = trainingPaths(0.5);
+    for(int workers : {1, 2, 4}){
+        bench.run("shardedCovariance", "205/pool2/" + to_string(workers) + "proc", [&](){
+            keep(shardedCovariance(paths, 2, workers).covariance[0]);
+        }, 2.0 * paths.size() * 1400 * 1400);
+    }
+
+    //recognition with a 10 by 8 prefilter and a 20 by 17 rerank against the 20 by 17 model alone, pooled from one decode
+    auto fullData = createData(0.5, 1);
+    auto cascade = trainCascade(get<0>(fullData), {8, 4}, 50, 10);
+    auto probes = get<1>(fullData);
+    Cascade fine;
+    fine.labels = cascade.labels;
+    fine.levels.push_back(cascade.levels[1]);
+
+    bench.run("recognize", "205/pool4/single", [&](){
+        int sum = 0;
+        for(const auto& probe : probes){
+            sum += recognize(fine, probe, 0);
+        }
+        keep(sum);
+    });
+    for(int shortlist : {5, 20}){
+        bench.run("recognize", "205/pool8>4/shortlist" + to_string(shortlist), [&](){
+            int sum = 0;
+            for(const auto& probe : probes){
+                sum += recognize(cascade, probe, shortlist);
+            }
+            keep(sum);
+        });
+    }
+
+    //the full 1400 by 1400 eigendecomposition takes hours, so Train is measured on faces pooled by 8 (80 pixels)
+    //with a fixed amount of QR iterations
+    auto data = createData(0.5, 8);
+    auto trainData = get<0>(data);
+    const int iterations = 10;
+
+    bench.scaling("Train", "205/pool8/" + to_string(iterations) + "it", [&](){
+        auto Vk = Train(trainData, 50, false, iterations);
+        keep(Vk.N);
+    });
+}
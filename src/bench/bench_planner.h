@@ -0,0 +1,109 @@
+#pragma once
+
+#include "bench.h"
+#include "../utils/pca.h"
+#include "../utils/planner.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+/*
+@brief growth of the resident memory while f runs, measured in a forked child so every call starts from the same heap
+@param f function to measure
+@returns bytes between the resident size before the call and the peak resident size of the child
+*/
+template<typename F>
+double peakBytes(F f){
+    int channel[2];
+    if(pipe(channel) != 0){
+        return 0.0;
+    }
+
+    pid_t pid = fork();
+    if(pid == 0){
+        close(channel[0]);
+        ThreadPool::isWorker() = true;
+
+        long pages = 0;
+        long resident = 0;
+        FILE* statm = fopen("/proc/self/statm", "r");
+        if(statm){
+            if(fscanf(statm, "%ld %ld", &pages, &resident) != 2){
+                resident = 0;
+            }
+            fclose(statm);
+        }
+
+        f();
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double bytes = 1024.0 * usage.ru_maxrss - double(resident) * sysconf(_SC_PAGESIZE);
+        ssize_t written = write(channel[1], &bytes, sizeof(bytes));
+        _exit(written == sizeof(bytes) ? 0 : 1);
+    }
+
+    close(channel[1]);
+    double bytes = 0.0;
+    if((pid < 0) || (read(channel[0], &bytes, sizeof(bytes)) != sizeof(bytes))){
+        bytes = 0.0;
+    }
+    close(channel[0]);
+    if(pid > 0){
+        waitpid(pid, nullptr, 0);
+    }
+    return bytes;
+}
+
+/*
+@brief run every training strategy on the same faces and compare the estimates of the planner with the measured time
+(the GFLOP/s column is the estimated flops over the measured time, so a constant rate means the estimates track the
+time) and with the measured peak memory
+@param bench the harness to collect the results in
+*/
+void PlannerBenchmarks(Bench& bench){
+
+    cout << "===== Planner Benchmarks =====" << endl;
+
+    auto budget = TrainingBudget::calibrated();
+    const int k = 20;
+    const int iterations = 3;
+
+    for(int poolingFactor : {8, 4}){
+        auto trainData = get<0>(createData(0.5, poolingFactor));
+        int pixels = trainData[0].data->M * trainData[0].data->N;
+        auto plan = planTraining(pixels, trainData.size(), k, iterations, budget);
+        printPlan(plan);
+
+        for(const auto& estimate : plan.estimates){
+            string size = "205/" + to_string(pixels) + "px/" + strategyName(estimate.strategy);
+            auto train = [&](){
+                auto Vk = TrainWith(trainData, estimate.strategy, k, budget, false, iterations);
+                keep(Vk.N);
+            };
+
+            auto result = bench.run("TrainWith", size, train, estimate.flops + estimate.serialFlops);
+            double measured = peakBytes(train);
+
+            cout << "    estimate " << fixed << setprecision(3) << estimate.seconds * 1e3 << " ms, "
+                 << estimate.bytes / (1 << 20) << " MB, measured " << result.median * 1e-6 << " ms, "
+                 << measured / (1 << 20) << " MB peak" << endl;
+        }
+    }
+
+    //the cost of a variance target follows the amount of eigenfaces it needs
+    auto trainData = get<0>(createData(0.5, 4));
+    for(float target : {0.5f, 0.8f, 0.95f}){
+        int k = 0;
+        bench.run("TrainToVariance", "205/340px/" + to_string(int(100 * target)) + "%", [&](){
+            k = TrainToVariance(trainData, target, budget).k;
+            keep(k);
+        });
+        cout << "    " << k << " eigenfaces" << endl;
+    }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "bench.h"
+#include "bench_matrix.h"
+#include "../utils/recognizer.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <random>
+
+using namespace std;
+
+/*
+@brief model of a random gallery with the geometry of the faces pooled by 2
+@param faces amount of gallery faces
+@param k amount of eigenfaces
+@param version number of the model
+*/
+unique_ptr<RecognitionModel> randomModel(int faces, int k, int version){
+    const int rows = 56;
+    const int cols = 46;
+
+    unique_ptr<RecognitionModel> model(new RecognitionModel());
+    model->version = version;
+    model->kernels = faceKernels(rows, cols);
+    model->mean = randomMatrix(rows * cols, 1, 21);
+    model->basis = randomMatrix(rows * cols, k, 22).reorder<ColMajor>();
+    model->weights = randomMatrix(faces, k, 23);
+    for(int i = 0; i<faces; i++){
+        model->labels.push_back(to_string(i));
+    }
+    return model;
+}
+
+/*
+@brief latency percentiles of single queries while reader threads query the recognizer continuously, once with a
+steady model and once while a writer publishes a new model every millisecond. With epoch reclamation the tail of the
+swapping run should stay close to the steady run
+@param bench the harness to collect the results in
+*/
+void RecognizerBenchmarks(Bench& bench){
+
+    cout << "===== Recognizer Benchmarks =====" << endl;
+
+    const int faces = 400;
+    const int k = 50;
+    const int readers = max(2, Parallel::threads());
+    const int queriesPerReader = 4000;
+
+    auto base = randomModel(faces, k, 0);
+    std::shared_ptr<Matrix<float>> face(new Matrix<float>(randomMatrix(56, 46, 24)));
+    Image probe("probe", 0, face);
+
+    Recognizer single(unique_ptr<RecognitionModel>(new RecognitionModel(*base)));
+    bench.run("recognizer/query", dims(faces, k), [&](){
+        keep(single.recognize(probe).distance);
+    }, 2.0 * 56 * 46 * k + 3.0 * faces * k);
+
+    cout << setw(10) << "mode" << setw(10) << "swaps" << setw(10) << "p50 [us]" << setw(10) << "p99" << setw(10)
+         << "p99.9" << setw(10) << "max" << endl;
+
+    for(bool swapping : {false, true}){
+        Recognizer recognizer(unique_ptr<RecognitionModel>(new RecognitionModel(*base)));
+        atomic<int> running(readers);
+        vector<vector<double>> latencies(readers);
+        vector<thread> threads;
+
+        for(int t = 0; t<readers; t++){
+            threads.emplace_back([&, t](){
+                latencies[t].reserve(queriesPerReader);
+                for(int i = 0; i<queriesPerReader; i++){
+                    auto start = chrono::steady_clock::now();
+                    keep(recognizer.recognize(probe).distance);
+                    latencies[t].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+                }
+                running--;
+            });
+        }
+
+        //the models are built before the run so the writer only publishes
+        int swaps = 0;
+        while(running.load() > 0){
+            if(swapping){
+                unique_ptr<RecognitionModel> next(new RecognitionModel(*base));
+                next->version = ++swaps;
+                recognizer.publish(move(next));
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        for(auto& thread : threads){
+            thread.join();
+        }
+
+        vector<double> all;
+        for(const auto& latency : latencies){
+            all.insert(all.end(), latency.begin(), latency.end());
+        }
+        sort(all.begin(), all.end());
+        auto percentile = [&](double p){
+            return all[min(int(p * all.size()), int(all.size()) - 1)];
+        };
+
+        cout << setw(10) << (swapping ? "swapping" : "steady") << setw(10) << swaps << fixed << setprecision(1)
+             << setw(10) << percentile(0.5) << setw(10) << percentile(0.99) << setw(10) << percentile(0.999)
+             << setw(10) << all.back() << endl;
+    }
+}
+
+/*
+@brief two-stage search over identity prototypes against the exact scan of a gallery with many images per identity. The
+images of an identity are drawn around a subject center, the probes are new images of random identities
+@param bench the harness to collect the results in
+*/
+void PrototypeBenchmarks(Bench& bench){
+
+    cout << "===== Prototype Benchmarks =====" << endl;
+
+    const int identities = 2000;
+    const int perIdentity = 20;
+    const int k = 50;
+    const int probes = 200;
+
+    mt19937 generator(31);
+    normal_distribution<float> spread(0.0, 0.6);
+    auto centers = randomMatrix(identities, k, 32);
+
+    RecognitionModel model;
+    model.weights = Matrix<float>(identities * perIdentity, k);
+    for(int i = 0; i<identities * perIdentity; i++){
+        for(int c = 0; c<k; c++){
+            model.weights(i, c) = centers(i / perIdentity, c) + spread(generator);
+        }
+        model.labels.push_back(to_string(i / perIdentity));
+    }
+
+    Matrix<float> probeWeights(probes, k);
+    vector<string> probeLabels;
+    for(int t = 0; t<probes; t++){
+        int identity = (t * 7919) % identities;
+        probeLabels.push_back(to_string(identity));
+        for(int c = 0; c<k; c++){
+            probeWeights(t, c) = centers(identity, c) + spread(generator);
+        }
+    }
+
+    //fraction of probes matched to an image of their own identity
+    auto accuracy = [&](int shortlist){
+        int correct = 0;
+        for(int t = 0; t<probes; t++){
+            correct += (model.search(&probeWeights(t, 0), shortlist).label == probeLabels[t]);
+        }
+        return float(correct) / probes;
+    };
+    string size = to_string(identities) + "x" + to_string(perIdentity) + "/" + to_string(k);
+    bench.run("prototypes/exact", size, [&](){
+        for(int t = 0; t<probes; t++){
+            keep(model.search(&probeWeights(t, 0), 0).index);
+        }
+    }, 3.0 * identities * perIdentity * k * probes);
+    cout << "    accuracy " << fixed << setprecision(3) << accuracy(0) << endl;
+
+    for(int prototypes : {1, 3}){
+        model.prototypes = IdentityPrototypes::build(model.weights, model.labels, prototypes);
+        for(int shortlist : {1, 5, 20}){
+            bench.run("prototypes/" + to_string(prototypes) + "per", size + "/top" + to_string(shortlist), [&](){
+                for(int t = 0; t<probes; t++){
+                    keep(model.search(&probeWeights(t, 0), shortlist).index);
+                }
+            }, 3.0 * (model.prototypes.owner.size() + shortlist * perIdentity) * k * probes);
+            cout << "    accuracy " << fixed << setprecision(3) << accuracy(shortlist) << endl;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "bench_matrix.h"
+#include "bench_pca.h"
+#include "bench_gallery.h"
+#include "bench_planner.h"
+#include "bench_recognizer.h"
+#include <string>
+
+using namespace std;
+
+/*
+usage: ./bench [output.json] [baseline.json]
+writes the results to output.json (bench.json by default) and compares them against baseline.json if given
+*/
+int main(int argc, char** argv){
+
+    string output = (argc > 1) ? argv[1] : "bench.json";
+
+    Bench bench(2, 10);
+
+    MatrixBenchmarks(bench);
+    BackendBenchmarks(bench);
+    PcaBenchmarks(bench);
+    GalleryBenchmarks(bench);
+    IndexBenchmarks(bench);
+    PlannerBenchmarks(bench);
+    RecognizerBenchmarks(bench);
+    PrototypeBenchmarks(bench);
+
+    bench.writeJSON(output);
+    cout << "===== Results written to " << output << " =====" << endl;
+
+    if(argc > 2){
+        bench.compare(argv[2]);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -1,19 +1,83 @@
 #include "utils/matrix.h"
 #include "utils/image.h"
 #include "utils/pca.h"
+#include "utils/evaluate.h"
+#include "utils/trace.h"
+#include "utils/cache.h"
+#include "utils/cascade.h"
+#include "utils/dataset.h"
+#include "utils/planner.h"
+#include "utils/recognizer.h"
 #include <iostream>
+#include <string>
 
 using namespace std;
 
-int main(){
+int main(int argc, char** argv){
 
-    setbuf(stdout, NULL);
+    //score every (split, k) combination instead of training a single model
+    if((argc > 1) && (string(argv[1]) == "sweep")){
+        TrainingCache cache("cache");
+        auto results = sweep({0.3, 0.5, 0.7}, {10, 25, 50, 100}, 2, 2, 50000, &cache);
+        printSweep(results);
+        cache.report();
+        return 0;
+    }
 
-    auto data = createData(0.5, 2);
-    auto trainData = get<0>(data);
-    auto testData = get<1>(data);
+    //prefilter with 10 by 8 faces and rerank the shortlist with 40 by 35 faces, compared with each resolution alone
+    if((argc > 1) && (string(argv[1]) == "cascade")){
+        TrainingCache cache("cache");
+        auto results = evaluateCascade(0.5, {8, 2}, 50, {5, 10, 20, 50}, 50000, &cache);
+        printCascade(results);
+        cache.report();
+        return 0;
+    }
 
-    auto Vk = Train(trainData, 100, true);
+    //rank the identities by their prototypes and compare only the images of the closest ones, against the exact scan
+    if((argc > 1) && (string(argv[1]) == "prototypes")){
+        TrainingCache cache("cache");
+        auto results = evaluatePrototypes(0.5, 50, {1, 2, 3}, {1, 3, 5, 10}, 50000, &cache);
+        printPrototypes(results);
+        cache.report();
+        return 0;
+    }
+
+    //as many eigenfaces as are needed to explain a fraction of the variance (./main variance [target])
+    if((argc > 1) && (string(argv[1]) == "variance")){
+        float target = (argc > 2) ? stof(argv[2]) : 0.95;
+        LazyDataset dataset(2);
+        auto trainData = dataset.load(get<0>(dataset.split(0.5)));
+        dataset.report();
+
+        TrainingCache cache("cache");
+        auto training = TrainToVariance(trainData, target, TrainingBudget(), true, 50000, &cache);
+        cache.report();
+
+        TRACE_WRITE("trace.json");
+        return 0;
+    }
+
+    //decode the images and accumulate the covariance in worker processes (./main sharded [workers])
+    if((argc > 1) && (string(argv[1]) == "sharded")){
+        int workers = (argc > 2) ? stoi(argv[2]) : 4;
+        auto Vk = TrainSharded(trainingPaths(0.5), 2, workers, 100, true, 50000, "train.ckpt");
+
+        TRACE_WRITE("trace.json");
+        return 0;
+    }
+
+    //only the training faces are decoded, the test faces stay paths until they are needed
+    LazyDataset dataset(2);
+    auto trainData = dataset.load(get<0>(dataset.split(0.5)));
+    dataset.report();
+
+    //the planner picks the covariance, Gram or iterative strategy from the shape, k and a 1 GB budget. Full covariance
+    //decompositions are cached in ./cache, a second run (also with another k) only reads the basis
+    TrainingCache cache("cache");
+    auto Vk = TrainPlanned(trainData, 100, TrainingBudget(), true, 50000, "train.ckpt", &cache);
+    cache.report();
+
+    TRACE_WRITE("trace.json");
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,38 @@
 #include "test_image.h"
 #include "test_matrix.h"
+#include "test_evaluate.h"
+#include "test_checkpoint.h"
+#include "test_parallel.h"
+#include "test_backend.h"
+#include "test_face.h"
+#include "test_shard.h"
+#include "test_cache.h"
+#include "test_gallery.h"
+#include "test_cascade.h"
+#include "test_dataset.h"
+#include "test_planner.h"
+#include "test_ivfpq.h"
+#include "test_recognizer.h"
+#include "test_memprofile.h"
 
 int main(){
 
     MatrixTests();
     ImageTests();
+    EvaluateTests();
+    CheckpointTests();
+    ParallelTests();
+    BackendTests();
+    FaceTests();
+    ShardTests();
+    CacheTests();
+    GalleryTests();
+    CascadeTests();
+    DatasetTests();
+    PlannerTests();
+    IndexTests();
+    RecognizerTests();
+    MemoryProfileTests();
 
     cout << "===== All Tests Passed =====" << endl;
 
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../utils/blas.h"
+#include "../utils/matrix.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+using namespace std;
+
+/*
+@brief run f with the external backend and with the built-in kernels (both are the built-in kernels in builds without
+the backend) and return both results
+*/
+template<typename F>
+auto withBothBackends(F f) -> pair<decltype(f()), decltype(f())> {
+    bool previous = Backend::enabled();
+    Backend::enabled() = true;
+    auto external = f();
+    Backend::enabled() = false;
+    auto native = f();
+    Backend::enabled() = previous;
+    return make_pair(external, native);
+}
+
+Matrix<float> randomTestMatrix(int M, int N, int seed){
+    mt19937 generator(seed);
+    uniform_real_distribution<float> distribution(-1.0, 1.0);
+    Matrix<float> result(M, N);
+    for(int i = 0; i<M*N; i++){
+        result[i] = distribution(generator);
+    }
+    return result;
+}
+
+template<StorageOrder OrderA, StorageOrder OrderB>
+void assertClose(const Matrix<float, OrderA>& a, const Matrix<float, OrderB>& b, float tolerance){
+    assert(a.M == b.M && a.N == b.N);
+    for(int i = 0; i<a.M; i++){
+        for(int j = 0; j<a.N; j++){
+            assert(fabs(a(i,j) - b(i,j)) < tolerance);
+        }
+    }
+}
+
+void testBackendMultMat(){
+    auto a = randomTestMatrix(37, 23, 1);
+    auto b = randomTestMatrix(23, 19, 2);
+    auto aCol = a.reorder<ColMajor>();
+    auto bCol = b.reorder<ColMajor>();
+
+    //every combination of storage orders of the operands and the result
+    auto row = withBothBackends([&](){ return Matrix<float>::multMat(a, b); });
+    auto rowMixed = withBothBackends([&](){ return Matrix<float>::multMat(aCol, b); });
+    auto col = withBothBackends([&](){ return Matrix<float, ColMajor>::multMat(aCol, bCol); });
+    auto colMixed = withBothBackends([&](){ return Matrix<float, ColMajor>::multMat(a, bCol); });
+    auto view = withBothBackends([&](){ return Matrix<float, ColMajor>::multMat(bCol.transposedView(), aCol.transposedView()); });
+
+    assertClose(row.first, row.second, 1e-4);
+    assertClose(rowMixed.first, row.second, 1e-4);
+    assertClose(col.first, row.second, 1e-4);
+    assertClose(colMixed.first, row.second, 1e-4);
+    assertClose(col.second, row.second, 1e-4);
+    assertClose(view.first, row.second.transpose(), 1e-4);
+    assertClose(view.second, row.second.transpose(), 1e-4);
+}
+
+void testBackendMultTransposed(){
+    auto a = randomTestMatrix(40, 9, 3);
+    auto aCol = a.reorder<ColMajor>();
+
+    auto row = withBothBackends([&](){ return Matrix<float>::multTransposed(a); });
+    auto col = withBothBackends([&](){ return Matrix<float, ColMajor>::multTransposed(aCol); });
+    auto reference = Matrix<float>::multMat(a, a.transpose());
+
+    assertClose(row.first, reference, 1e-4);
+    assertClose(row.second, reference, 1e-4);
+    assertClose(col.first, reference, 1e-4);
+    assertClose(col.second, reference, 1e-4);
+}
+
+void testBackendQR(){
+    auto a = randomTestMatrix(12, 8, 4).reorder<ColMajor>();
+
+    auto qr = withBothBackends([&](){ return a.QRDecomposition(); });
+    assertClose(get<0>(qr.first), get<0>(qr.second), 1e-4);
+    assertClose(get<1>(qr.first), get<1>(qr.second), 1e-4);
+
+    //Q * R gives back a
+    auto product = get<0>(qr.first) * get<1>(qr.first);
+    assertClose(product, a, 1e-4);
+}
+
+void testBackendEigen(){
+    //symmetric with well separated eigenvalues so the QR iterations converge quickly
+    const int n = 10;
+    auto noise = randomTestMatrix(n, n, 5);
+    Matrix<float> a(n, n);
+    for(int i = 0; i<n; i++){
+        for(int j = 0; j<n; j++){
+            a(i,j) = 0.1f * (noise(i,j) + noise(j,i)) + ((i == j) ? 10.0f * (n - i) : 0.0f);
+        }
+    }
+
+    auto result = withBothBackends([&](){ return a.eigen(2000); });
+    auto E = get<0>(result.first);
+    auto e = get<1>(result.first);
+    auto nativeE = get<0>(result.second);
+    auto nativeValues = get<1>(result.second);
+
+    for(int j = 0; j<n; j++){
+        assert(fabs(e[j] - nativeValues[j]) < 1e-3 * fabs(e[j]));
+
+        //eigenvectors agree up to their sign
+        float dot = 0.0;
+        for(int i = 0; i<n; i++){
+            dot += E(i,j) * nativeE(i,j);
+        }
+        assert(fabs(fabs(dot) - 1.0f) < 1e-3);
+    }
+}
+
+int BackendTests(){
+
+    cout << "===== Running Backend Tests (" << (Backend::compiled() ? "blas" : "native") << ") =====" << endl;
+
+    testBackendMultMat();
+    testBackendMultTransposed();
+    testBackendQR();
+    testBackendEigen();
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../utils/cache.h"
+#include "../utils/pca.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace std;
+
+TrainingArtifacts testArtifacts(uint64_t key, int pixels){
+    TrainingArtifacts artifacts;
+    artifacts.key = key;
+    artifacts.mean = Matrix<float>(pixels, 1);
+    artifacts.values = Matrix<float, ColMajor>(pixels, 1);
+    artifacts.basis = Matrix<float, ColMajor>(pixels, pixels);
+    for(int i = 0; i<pixels; i++){
+        artifacts.mean[i] = float(key + i);
+        artifacts.values[i] = float(pixels - i);
+    }
+    for(int i = 0; i<pixels*pixels; i++){
+        artifacts.basis[i] = float(i) * 0.5f;
+    }
+    return artifacts;
+}
+
+void clearCache(TrainingCache& cache, const vector<uint64_t>& keys){
+    for(uint64_t key : keys){
+        remove(cache.path(key).c_str());
+    }
+    rmdir(cache.directory.c_str());
+}
+
+void setUsed(const string& file, long seconds){
+    struct timeval times[2];
+    times[0].tv_sec = seconds;
+    times[0].tv_usec = 0;
+    times[1] = times[0];
+    assert(utimes(file.c_str(), times) == 0);
+}
+
+void testCacheRoundTrip(){
+    TrainingCache cache("test_cache");
+    auto artifacts = testArtifacts(7, 6);
+
+    TrainingArtifacts result;
+    assert(!cache.lookup(7, result));
+    cache.store(artifacts);
+    assert(cache.lookup(7, result));
+    assert(!cache.lookup(8, result));
+
+    assert(result.key == 7 && result.mean.M == 6 && result.basis.N == 6);
+    for(int i = 0; i<36; i++){
+        assert(result.basis[i] == artifacts.basis[i]);
+    }
+    assert(result.values[0] == 6 && result.mean[5] == 12);
+    assert(cache.hits == 1 && cache.misses == 2);
+
+    clearCache(cache, {7});
+}
+
+void testCacheEviction(){
+    //each entry is 4 + 8 + 4 + (4 + 4 + 16) * 4 bytes = 112 bytes, room for two
+    TrainingCache cache("test_cache", 250);
+    TrainingArtifacts result;
+
+    //the entries are dated explicitly, so the order does not depend on the timestamp resolution of the file system
+    cache.store(testArtifacts(1, 4));
+    cache.store(testArtifacts(2, 4));
+    setUsed(cache.path(1), 1000);
+    setUsed(cache.path(2), 2000);
+
+    //using entry 1 makes entry 2 the least recently used one
+    assert(cache.lookup(1, result));
+    cache.store(testArtifacts(3, 4));
+
+    assert(cache.evictions == 1);
+    assert(cache.lookup(1, result));
+    assert(!cache.lookup(2, result));
+    assert(cache.lookup(3, result));
+
+    clearCache(cache, {1, 2, 3});
+}
+
+void testTrainServedFromCache(){
+    auto paths = trainingPaths(0.5);
+    vector<Image> trainData;
+    for(int i = 0; i<12; i++){
+        trainData.push_back(Image(paths[i].c_str(), 8));
+    }
+
+    TrainingCache cache("test_cache");
+    auto computed = Train(trainData, 5, false, 3, "", &cache);
+    assert(cache.misses == 1 && cache.hits == 0);
+
+    //another k is a slice of the cached basis
+    auto cached = Train(trainData, 8, false, 3, "", &cache);
+    assert(cache.hits == 1);
+    assert(cached.M == computed.M && cached.N == 8);
+    for(int i = 0; i<computed.M; i++){
+        for(int j = 0; j<5; j++){
+            assert(cached(i,j) == computed(i,j));
+        }
+    }
+
+    //different parameters are a different key
+    Train(trainData, 5, false, 4, "", &cache);
+    assert(cache.misses == 2);
+
+    clearCache(cache, {trainingKey(trainData, 3), trainingKey(trainData, 4)});
+}
+
+int CacheTests(){
+
+    cout << "===== Running Cache Tests =====" << endl;
+
+    testCacheRoundTrip();
+    testCacheEviction();
+    testTrainServedFromCache();
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../utils/cascade.h"
+#include "../utils/image.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+void testImagePooled(){
+    std::shared_ptr<Matrix<float>> data(new Matrix<float>(5, 6));
+    for(int i = 0; i<30; i++){
+        data->operator[](i) = float(i);
+    }
+    Image image("3", 4, data);
+
+    //the last row does not fill a block and is dropped
+    Image pooled = image.pooled(2);
+    assert(pooled.name == "3" && pooled.imageNumber == 4);
+    assert(pooled.data->M == 2 && pooled.data->N == 3);
+    assert(pooled.data->operator()(0, 0) == (0.0f + 1.0f + 6.0f + 7.0f) / 4.0f);
+    assert(pooled.data->operator()(1, 2) == (16.0f + 17.0f + 22.0f + 23.0f) / 4.0f);
+    assert(image.pooled(1).data->M == 5);
+
+    bool thrown = false;
+    try{
+        image.pooled(0);
+    }
+    catch(const domain_error&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testCascadeShortlist(){
+    //12 random 16 by 16 faces of 4 subjects, the probes are the training faces with noise
+    mt19937 generator(3);
+    uniform_real_distribution<float> pixel(0.0, 255.0);
+    normal_distribution<float> noise(0.0, 20.0);
+
+    vector<Image> trainData;
+    vector<Image> probes;
+    for(int i = 0; i<12; i++){
+        std::shared_ptr<Matrix<float>> face(new Matrix<float>(16, 16));
+        std::shared_ptr<Matrix<float>> probe(new Matrix<float>(16, 16));
+        for(int p = 0; p<256; p++){
+            face->operator[](p) = pixel(generator);
+            probe->operator[](p) = face->operator[](p) + noise(generator);
+        }
+        trainData.push_back(Image(to_string(i % 4), i / 4, face));
+        probes.push_back(Image(to_string(i % 4), i / 4, probe));
+    }
+
+    Cascade cascade = trainCascade(trainData, {2, 4}, 8, 200);
+    assert(cascade.levels.size() == 2);
+    assert(cascade.levels[0].poolingFactor == 4 && cascade.levels[0].kernels.pixels == 16);
+    assert(cascade.levels[1].poolingFactor == 2 && cascade.levels[1].weights.M == 12 && cascade.levels[1].weights.N == 8);
+
+    Cascade coarse;
+    coarse.labels = cascade.labels;
+    coarse.levels.push_back(cascade.levels[0]);
+    Cascade fine;
+    fine.labels = cascade.labels;
+    fine.levels.push_back(cascade.levels[1]);
+
+    for(const auto& probe : probes){
+        //a shortlist with every face is the fine model, a shortlist of one face is the coarse model
+        assert(recognize(cascade, probe, 0) == recognize(fine, probe, 0));
+        assert(recognize(cascade, probe, 12) == recognize(fine, probe, 0));
+        assert(recognize(cascade, probe, 1) == recognize(coarse, probe, 0));
+
+        int index = recognize(cascade, probe, 4);
+        assert(index >= 0 && index < 12);
+    }
+}
+
+int CascadeTests(){
+
+    cout << "===== Running Cascade Tests =====" << endl;
+
+    testImagePooled();
+    testCascadeShortlist();
+
+    return 0;
+}
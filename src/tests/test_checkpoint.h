@@ -0,0 +1,147 @@
+#pragma once
+
+#include "../utils/checkpoint.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+
+void testCheckpointRoundTrip(){
+    float values[] = {1, 2, 3, 4};
+    float vectors[] = {5, 6, 7, 8};
+
+    EigenCheckpoint checkpoint;
+    checkpoint.key = 1234;
+    checkpoint.iteration = 17;
+    checkpoint.residual = 0.5;
+    checkpoint.values = Matrix<float, ColMajor>(2, 2, values);
+    checkpoint.vectors = Matrix<float, ColMajor>(2, 2, vectors);
+
+    writeCheckpoint("test_checkpoint.bin", checkpoint);
+
+    EigenCheckpoint result;
+    assert(readCheckpoint("test_checkpoint.bin", result));
+    assert(result.key == 1234);
+    assert(result.iteration == 17);
+    assert(result.residual == 0.5);
+    for(int i = 0; i<4; i++){
+        assert(result.values[i] == values[i]);
+        assert(result.vectors[i] == vectors[i]);
+    }
+
+    //another dimension than the expected one is rejected
+    assert(readCheckpoint("test_checkpoint.bin", result, 2));
+    assert(!readCheckpoint("test_checkpoint.bin", result, 3));
+
+    //a header that claims more data than the file holds is rejected before anything is allocated
+    {
+        fstream file("test_checkpoint.bin", ios::binary | ios::in | ios::out);
+        int M = 1 << 20;
+        file.seekp(4 + sizeof(uint64_t) + sizeof(int) + sizeof(float));
+        file.write(reinterpret_cast<const char*>(&M), sizeof(M));
+    }
+    assert(!readCheckpoint("test_checkpoint.bin", result));
+
+    //a truncated file is rejected
+    writeCheckpoint("test_checkpoint.bin", checkpoint);
+    assert(truncate("test_checkpoint.bin", 40) == 0);
+    assert(!readCheckpoint("test_checkpoint.bin", result));
+
+    remove("test_checkpoint.bin");
+    assert(!readCheckpoint("test_checkpoint.bin", result));
+}
+
+void testCheckpointResume(){
+    float data[] = {4, -30, 60, -35, -30, 300, -675, 420, 60, -675, 1620, -1050, -35, 420, -1050, 700};
+    Matrix<float> mat(4,4,data);
+
+    //only the QR iterations of the built-in backend are checkpointed
+    bool backend = Backend::enabled();
+    Backend::enabled() = false;
+
+    auto expected = mat.eigen(40);
+
+    //stop halfway, the last snapshot is written when the checkpointer is destroyed
+    {
+        Checkpointer checkpointer("test_resume.bin", hashMatrix(mat));
+        mat.eigen(40, combineCallbacks(checkpointer.callback(), [](const EigenProgress& progress){
+            return progress.iteration < 20;
+        }), 5);
+    }
+
+    EigenCheckpoint checkpoint;
+    assert(readCheckpoint("test_resume.bin", checkpoint));
+    assert(checkpoint.iteration == 20);
+
+    //resuming is silent unless verbose
+    stringstream captured;
+    streambuf* console = cout.rdbuf(captured.rdbuf());
+    auto result = checkpointedEigen(mat, 40, "test_resume.bin", 5);
+    cout.rdbuf(console);
+    assert(captured.str().empty());
+
+    for(int i = 0; i<16; i++){
+        assert(abs(get<0>(result)[i] - get<0>(expected)[i]) < 0.0001);
+    }
+    for(int i = 0; i<4; i++){
+        assert(abs(get<1>(result)[i] - get<1>(expected)[i]) < 0.0001);
+    }
+
+    //a checkpoint of another matrix is ignored
+    float other[] = {2, 0, 0, 0, 0, 3, 0, 0, 0, 0, 4, 0, 0, 0, 0, 5};
+    Matrix<float> otherMat(4,4,other);
+    auto otherResult = checkpointedEigen(otherMat, 1, "test_resume.bin", 1);
+    assert(get<1>(otherResult)[0] == 2);
+
+    remove("test_resume.bin");
+    Backend::enabled() = backend;
+}
+
+void testCheckpointInterval(){
+    float data[] = {2, 1, 1, 2};
+    Matrix<float> mat(2,2,data);
+    auto callback = [](const EigenProgress&){ return true; };
+
+    //an interval below 1 is rejected instead of dividing by zero
+    for(int interval : {0, -1}){
+        bool thrown = false;
+        try{
+            mat.eigen(10, callback, interval);
+        }catch(const domain_error&){
+            thrown = true;
+        }
+        assert(thrown);
+
+        thrown = false;
+        try{
+            Matrix<float>::resumeEigen(mat.reorder<ColMajor>(), mat.identity().reorder<ColMajor>(), 0, 10, callback, interval);
+        }catch(const domain_error&){
+            thrown = true;
+        }
+        assert(thrown);
+
+        thrown = false;
+        try{
+            checkpointedEigen(mat, 10, "test_interval.bin", interval);
+        }catch(const domain_error&){
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    remove("test_interval.bin");
+}
+
+int CheckpointTests(){
+
+    cout << "===== Running Checkpoint Tests =====" << endl;
+
+    testCheckpointRoundTrip();
+    testCheckpointResume();
+    testCheckpointInterval();
+
+    return 0;
+}
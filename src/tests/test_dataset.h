@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../utils/dataset.h"
+#include "../utils/pca.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+bool sameFace(const Image& a, const Image& b){
+    if((a.name != b.name) || (a.imageNumber != b.imageNumber) || (a.data->M != b.data->M) || (a.data->N != b.data->N)){
+        return false;
+    }
+    for(int i = 0; i<a.data->M * a.data->N; i++){
+        if(a.data->operator[](i) != b.data->operator[](i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+void testDatasetSplit(){
+    //nothing is decoded to split
+    LazyDataset dataset(8, 1 << 20, 0);
+    auto indices = dataset.split(0.5);
+    assert(dataset.size() == 410);
+    assert(get<0>(indices).size() == 205 && get<1>(indices).size() == 205);
+    assert(dataset.misses == 0 && dataset.bytes == 0);
+
+    auto paths = trainingPaths(0.5);
+    for(int i = 0; i<paths.size(); i++){
+        assert(dataset.records[get<0>(indices)[i]].path == paths[i]);
+    }
+}
+
+void testDatasetEviction(){
+    //room for three 10 by 8 faces
+    const size_t face = sizeof(float) * 10 * 8;
+    LazyDataset dataset(8, 3 * face, 0);
+
+    for(int i = 0; i<6; i++){
+        Image image = dataset.get(i);
+        assert(sameFace(image, Image(dataset.records[i].path.c_str(), 8)));
+    }
+    assert(dataset.misses == 6 && dataset.hits == 0 && dataset.evictions == 3);
+    assert(dataset.bytes == 3 * face && dataset.peakBytes <= 4 * face);
+
+    //5 is resident, 0 was evicted first
+    dataset.get(5);
+    assert(dataset.hits == 1);
+    dataset.get(0);
+    assert(dataset.misses == 7);
+
+    bool thrown = false;
+    try{
+        dataset.get(410);
+    }
+    catch(const out_of_range&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testDatasetPrefetch(){
+    //not sequential, so only load's window is prefetched
+    LazyDataset dataset(8, 1 << 20, 4);
+    vector<int> indices;
+    for(int i = 0; i<16; i++){
+        indices.push_back(20 + 2 * i);
+    }
+    auto images = dataset.load(indices);
+
+    assert(images.size() == indices.size());
+    for(int i = 0; i<indices.size(); i++){
+        assert(sameFace(images[i], Image(dataset.records[indices[i]].path.c_str(), 8)));
+    }
+    //every face was decoded exactly once, by the background thread or by load
+    lock_guard<mutex> lock(dataset.m);
+    assert(dataset.misses + dataset.prefetched == indices.size());
+    assert(dataset.hits + dataset.misses == indices.size());
+    assert(dataset.entries.size() == indices.size());
+    assert(dataset.decoding.empty());
+}
+
+void testDatasetPrefetchWindow(){
+    //a cache that is much smaller than the faces that are loaded still returns every face
+    const size_t face = sizeof(float) * 10 * 8;
+    LazyDataset dataset(8, 4 * face, 2);
+    vector<int> indices;
+    for(int i = 0; i<30; i++){
+        indices.push_back((7 * i) % 60);
+    }
+    auto images = dataset.load(indices);
+
+    for(int i = 0; i<indices.size(); i++){
+        assert(sameFace(images[i], Image(dataset.records[indices[i]].path.c_str(), 8)));
+    }
+    lock_guard<mutex> lock(dataset.m);
+    assert(dataset.hits + dataset.misses == indices.size());
+    assert(dataset.bytes <= 4 * face);
+}
+
+void testDatasetThreads(){
+    //several threads on a cache with room for 5 faces
+    LazyDataset dataset(8, 5 * sizeof(float) * 10 * 8, 2);
+    vector<thread> threads;
+    vector<bool> correct(4, true);
+
+    for(int t = 0; t<4; t++){
+        threads.emplace_back([&, t](){
+            for(int i = 0; i<30; i++){
+                int index = (i * (t + 1)) % 40;
+                Image image = dataset.get(index);
+                if(image.name != dataset.records[index].name || image.data->M != 10){
+                    correct[t] = false;
+                }
+            }
+        });
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+
+    for(bool c : correct){
+        assert(c);
+    }
+    assert(dataset.hits + dataset.misses == 120);
+    assert(dataset.bytes <= 5 * sizeof(float) * 10 * 8);
+}
+
+int DatasetTests(){
+
+    cout << "===== Running Dataset Tests =====" << endl;
+
+    testDatasetSplit();
+    testDatasetEviction();
+    testDatasetPrefetch();
+    testDatasetPrefetchWindow();
+    testDatasetThreads();
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../utils/evaluate.h"
+#include <iostream>
+#include <cassert>
+#include <set>
+#include <string>
+
+using namespace std;
+
+void testCountCorrectForEachK(){
+    //probe is closest to "b" on the first component but closest to "a" on both
+    float train[] = {0, 0, 1, 5};
+    float test[] = {1, 0};
+    Matrix<float> trainW(2, 2, train);
+    Matrix<float> testW(1, 2, test);
+
+    auto correct = countCorrectForEachK(trainW, {"a", "b"}, testW, {"b"}, {1, 2});
+
+    assert(correct.size() == 2);
+    assert(correct[0] == 1);
+    assert(correct[1] == 0);
+}
+
+void testCountCorrectForEachKDuplicate(){
+    float train[] = {0, 0, 0, 3, 3, 3};
+    float test[] = {0, 1, 0, 3, 3, 2};
+    Matrix<float> trainW(2, 3, train);
+    Matrix<float> testW(2, 3, test);
+
+    auto correct = countCorrectForEachK(trainW, {"a", "b"}, testW, {"a", "b"}, {1, 3, 3});
+
+    assert(correct[0] == 2);
+    assert(correct[1] == 2);
+    assert(correct[2] == 2);
+}
+
+void testSplitFolds(){
+    //three subjects with the image numbers 0 to 9 like the dataset
+    vector<Image> images;
+    for(int subject = 1; subject<=3; subject++){
+        for(int number = 0; number<10; number++){
+            std::shared_ptr<Matrix<float>> face(new Matrix<float>(2, 2));
+            images.push_back(Image(to_string(subject), number, face));
+        }
+    }
+
+    //every fold shifts the window by the size of the test set, so the test sets of the folds partition the images
+    for(float split : {0.5f, 0.8f, 0.9f}){
+        int testPerSubject = 10 - int(split * 10);
+        int folds = 10 / testPerSubject;
+        set<pair<string, int>> covered;
+
+        for(int fold = 0; fold<folds; fold++){
+            auto data = splitData(images, split, fold);
+            assert(get<0>(data).size() + get<1>(data).size() == images.size());
+            assert(get<1>(data).size() == 3 * testPerSubject);
+
+            for(const auto& image : get<1>(data)){
+                //disjoint from the test sets of the earlier folds
+                assert(covered.insert(make_pair(image.name, image.imageNumber)).second);
+            }
+        }
+        assert(covered.size() == images.size());
+    }
+}
+
+int EvaluateTests(){
+
+    cout << "===== Running Evaluate Tests =====" << endl;
+
+    testCountCorrectForEachK();
+    testCountCorrectForEachKDuplicate();
+    testSplitFolds();
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../utils/face.h"
+#include "../utils/matrix.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+void testFaceKernelDispatch(){
+    assert(faceKernels(40, 35).fixed);
+    assert(faceKernels(10, 8).fixed);
+    assert(faceKernels(56, 46).fixed);
+    assert(!faceKernels(41, 35).fixed);
+    assert(faceKernels(41, 35).pixels == 41 * 35);
+
+    bool thrown = false;
+    try{
+        faceKernels(0, 35);
+    }
+    catch(const domain_error&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testFaceKernelsAgree(){
+    //10 by 8 has a specialization, the dynamic table is built for the same geometry
+    auto fixed = faceKernels(10, 8);
+    auto dynamic = makeFaceKernelTable<0>(10, 8);
+    const int pixels = 80;
+    const int k = 3;
+
+    vector<float> face(pixels);
+    vector<float> mean(pixels);
+    Matrix<float, ColMajor> basis(pixels, k);
+    for(int i = 0; i<pixels; i++){
+        face[i] = float(i % 13);
+        mean[i] = float(i % 5) * 0.5f;
+        for(int c = 0; c<k; c++){
+            basis(i, c) = float((i + c) % 7) - 3.0f;
+        }
+    }
+
+    vector<float> fixedSum(pixels, 1.0);
+    vector<float> dynamicSum(pixels, 1.0);
+    fixed.accumulate(face.data(), fixedSum.data(), fixed.pixels);
+    dynamic.accumulate(face.data(), dynamicSum.data(), dynamic.pixels);
+
+    vector<float> fixedCentered(pixels);
+    vector<float> dynamicCentered(pixels);
+    fixed.center(face.data(), mean.data(), fixedCentered.data(), fixed.pixels);
+    dynamic.center(face.data(), mean.data(), dynamicCentered.data(), dynamic.pixels);
+
+    for(int i = 0; i<pixels; i++){
+        assert(fixedSum[i] == face[i] + 1.0f && dynamicSum[i] == fixedSum[i]);
+        assert(fixedCentered[i] == face[i] - mean[i] && dynamicCentered[i] == fixedCentered[i]);
+    }
+
+    vector<float> fixedWeights(k);
+    vector<float> dynamicWeights(k);
+    fixed.project(fixedCentered.data(), basis.data.get(), k, fixedWeights.data(), fixed.pixels);
+    dynamic.project(dynamicCentered.data(), basis.data.get(), k, dynamicWeights.data(), dynamic.pixels);
+
+    for(int c = 0; c<k; c++){
+        float expected = 0.0;
+        for(int i = 0; i<pixels; i++){
+            expected += fixedCentered[i] * basis(i, c);
+        }
+        assert(fabs(fixedWeights[c] - expected) < 1e-3);
+        assert(fixedWeights[c] == dynamicWeights[c]);
+    }
+}
+
+void testProjectBytes(){
+    //more pixels than one block and a batch with a remainder, the fixed and the dynamic kernels agree with project
+    const int rows = 20;
+    const int cols = 17;
+    const int pixels = rows * cols;
+    const int k = 5;
+    const int count = 7;
+
+    vector<vector<uint8_t>> faces(count, vector<uint8_t>(pixels));
+    vector<const uint8_t*> pointers;
+    vector<float> mean(pixels);
+    Matrix<float, ColMajor> basis(pixels, k);
+    for(int i = 0; i<pixels; i++){
+        mean[i] = float(i % 11) * 10.0f;
+        for(int c = 0; c<k; c++){
+            basis(i, c) = float((i * (c + 1)) % 9) / 9.0f - 0.5f;
+        }
+        for(int f = 0; f<count; f++){
+            faces[f][i] = uint8_t((i * 7 + f * 31) % 256);
+        }
+    }
+    for(const auto& face : faces){
+        pointers.push_back(face.data());
+    }
+
+    for(auto kernels : {faceKernels(rows, cols), makeFaceKernelTable<0>(rows, cols)}){
+        vector<float> weights(count * k);
+        kernels.projectBytes(pointers.data(), count, mean.data(), basis.data.get(), k, weights.data(), kernels.pixels);
+
+        for(int f = 0; f<count; f++){
+            vector<float> centered(pixels);
+            vector<float> expected(k);
+            for(int i = 0; i<pixels; i++){
+                centered[i] = float(faces[f][i]) - mean[i];
+            }
+            kernels.project(centered.data(), basis.data.get(), k, expected.data(), kernels.pixels);
+            for(int c = 0; c<k; c++){
+                assert(fabs(weights[f * k + c] - expected[c]) < 1e-3 * max(1.0f, fabs(expected[c])));
+            }
+        }
+    }
+}
+
+int FaceTests(){
+
+    cout << "===== Running Face Kernel Tests =====" << endl;
+
+    testFaceKernelDispatch();
+    testFaceKernelsAgree();
+    testProjectBytes();
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../utils/gallery.h"
+#include "../utils/matrix.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+void testParseCpuList(){
+    vector<int> cpus = NumaTopology::parseCpuList("0-3,8,10-11\n");
+    vector<int> expected = {0, 1, 2, 3, 8, 10, 11};
+    assert(cpus == expected);
+    assert(NumaTopology::parseCpuList("").empty());
+
+    auto topology = NumaTopology::detect();
+    assert(!topology.nodes.empty() && topology.cpus() >= 1);
+    assert(NumaTopology::split(2).cpus() == NumaTopology::single().cpus());
+}
+
+void testGallerySearch(){
+    //distinct distances so the order of the matches is unique
+    const int rows = 97;
+    const int dims = 5;
+    Matrix<float> gallery(rows, dims);
+    for(int i = 0; i<rows; i++){
+        for(int c = 0; c<dims; c++){
+            gallery(i, c) = float((i * 37 + c * 11) % 101) + 0.001f * i;
+        }
+    }
+    Matrix<float> probes(3, dims);
+    for(int i = 0; i<3 * dims; i++){
+        probes[i] = float(i * 13 % 50);
+    }
+
+    //brute force reference
+    vector<vector<GalleryMatch>> expected(3);
+    for(int p = 0; p<3; p++){
+        for(int i = 0; i<rows; i++){
+            float distance = 0.0;
+            for(int c = 0; c<dims; c++){
+                float diff = probes(p, c) - gallery(i, c);
+                distance += diff * diff;
+            }
+            GalleryMatch match = {i, distance};
+            expected[p].push_back(match);
+        }
+        sort(expected[p].begin(), expected[p].end());
+    }
+
+    //one node, a simulated two node layout, more shards than CPUs and one shard per row
+    vector<ShardedGallery*> galleries = {new ShardedGallery(gallery, NumaTopology::single()),
+                                         new ShardedGallery(gallery, NumaTopology::split(2), 3),
+                                         new ShardedGallery(gallery, NumaTopology::single(), 200)};
+    assert(galleries[2]->shards.size() == rows);
+
+    for(auto g : galleries){
+        for(int k : {1, 7, 200}){
+            auto results = g->search(probes, k);
+            assert(results.size() == 3);
+
+            for(int p = 0; p<3; p++){
+                assert(results[p].size() == min(k, rows));
+                for(int j = 0; j<results[p].size(); j++){
+                    assert(results[p][j].index == expected[p][j].index);
+                    assert(results[p][j].distance == expected[p][j].distance);
+                }
+            }
+        }
+        delete g;
+    }
+}
+
+int GalleryTests(){
+
+    cout << "===== Running Gallery Tests =====" << endl;
+
+    testParseCpuList();
+    testGallerySearch();
+
+    return 0;
+}
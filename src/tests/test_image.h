@@ -3,6 +3,8 @@
 #include "../utils/image.h"
 #include <iostream>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -30,6 +32,58 @@ void testInitImage3(){
     assert(result.imageNumber == 0);
 }
 
+void testJpegSize(){
+    int rows = 0;
+    int cols = 0;
+    assert(Image::jpegSize("../images/archive/1_1.jpg", rows, cols));
+    assert(rows == 80 && cols == 70);
+    assert(!Image::jpegSize("../images/archive/missing.jpg", rows, cols));
+
+    assert(Image::decodeReduction(2, 80, 70) == 2);
+    assert(Image::decodeReduction(8, 80, 72) == 8);
+    //the blocks of 4 and 8 pixels do not tile 70 columns
+    assert(Image::decodeReduction(8, 80, 70) == 2);
+    assert(Image::decodeReduction(3, 80, 70) == 1);
+}
+
+void testPooledImage(){
+    //the pixels are copied from the pooled image, not from the top left corner of the full one
+    Image full("../images/archive/1_1.jpg", 1);
+    Image pooled("../images/archive/1_1.jpg", 2, false);
+    assert(pooled.data->M == 40 && pooled.data->N == 35);
+
+    float block = 0.0;
+    for(int di = 0; di < 2; di++){
+        for(int dj = 0; dj < 2; dj++){
+            block += full.data->operator()(20 + di, 20 + dj) / 4.0f;
+        }
+    }
+    assert(fabs(pooled.data->operator()(10, 10) - block) <= 1.0f);
+}
+
+void testReducedDecode(){
+    //decoding at a reduced scale matches decoding the full image and resizing it with INTER_AREA
+    for(int poolingFactor : {2, 4, 8}){
+        double total = 0.0;
+        double worst = 0.0;
+        int pixels = 0;
+        for(const char* path : {"../images/archive/1_1.jpg", "../images/archive/205_21.jpg", "../images/archive/410_41.jpg"}){
+            Image full(path, poolingFactor, false);
+            Image reduced(path, poolingFactor, true);
+            assert(full.data->M == reduced.data->M && full.data->N == reduced.data->N);
+            assert(full.name == reduced.name && full.imageNumber == reduced.imageNumber);
+
+            for(int i = 0; i < full.data->M * full.data->N; i++){
+                double diff = fabs(full.data->operator[](i) - reduced.data->operator[](i));
+                total += diff;
+                worst = max(worst, diff);
+                pixels++;
+            }
+        }
+        assert(total / pixels < 1.0);
+        assert(worst <= ((poolingFactor == 2) ? 1.0 : 16.0));
+    }
+}
 
 int ImageTests(){
 
@@ -38,6 +92,9 @@ int ImageTests(){
     testInitImage1();
     testInitImage2();
     testInitImage3();
+    testJpegSize();
+    testPooledImage();
+    testReducedDecode();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../utils/ivfpq.h"
+#include "../utils/matrix.h"
+#include <iostream>
+#include <cassert>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/*
+@brief faces of subjects around random centers, like the projected weights of several images per subject
+*/
+Matrix<float> clusteredWeights(int subjects, int perSubject, int dims, float spread, int seed){
+    mt19937 generator(seed);
+    normal_distribution<float> center(0.0, 10.0);
+    normal_distribution<float> noise(0.0, spread);
+
+    Matrix<float> centers(subjects, dims);
+    for(int i = 0; i<subjects * dims; i++){
+        centers[i] = center(generator);
+    }
+
+    Matrix<float> weights(subjects * perSubject, dims);
+    for(int i = 0; i<subjects * perSubject; i++){
+        for(int c = 0; c<dims; c++){
+            weights(i, c) = centers(i % subjects, c) + noise(generator);
+        }
+    }
+    return weights;
+}
+
+void testKmeans(){
+    //two well separated groups
+    float values[] = {0, 0, 0, 1, 1, 0, 10, 10, 10, 11, 11, 10};
+    Matrix<float> points(6, 2, values);
+    auto centroids = kmeans(points, 2, 10);
+
+    float low = min(centroids(0, 0), centroids(1, 0));
+    float high = max(centroids(0, 0), centroids(1, 0));
+    assert(fabs(low - 1.0f / 3.0f) < 1e-5 && fabs(high - 31.0f / 3.0f) < 1e-5);
+}
+
+void testIndexSearch(){
+    const int dims = 12;
+    auto gallery = clusteredWeights(60, 8, dims, 0.5, 1);
+    auto probes = clusteredWeights(60, 1, dims, 0.5, 1);
+
+    IVFPQIndex index(dims, 8, 12);
+    index.train(gallery, 15);
+    index.add(gallery);
+
+    assert(index.size() == 480);
+    //6 bytes of codes and an id per face, rounded to blocks of 16 faces per list, plus the centroids
+    assert(index.bytes() < 480 * 10 + 8 * 16 * 6 + sizeof(float) * (8 * dims + 16 * dims));
+
+    //visiting every list finds a face of the right subject for (nearly) every probe
+    auto results = index.search(probes, 5, 8);
+    int correct = 0;
+    for(int q = 0; q<probes.M; q++){
+        assert(results[q].size() == 5);
+        for(int i = 1; i<5; i++){
+            assert(!(results[q][i] < results[q][i - 1]));
+        }
+        correct += (results[q][0].index % 60 == q % 60);
+    }
+    assert(correct >= 57);
+
+    //the shuffle and the scalar scan add up the same 8 bit tables
+    IVFPQIndex::shuffleEnabled() = false;
+    auto scalar = index.search(probes, 5, 3);
+    IVFPQIndex::shuffleEnabled() = true;
+    auto shuffled = index.search(probes, 5, 3);
+    for(int q = 0; q<probes.M; q++){
+        for(int i = 0; i<5; i++){
+            assert(scalar[q][i].index == shuffled[q][i].index && scalar[q][i].distance == shuffled[q][i].distance);
+        }
+    }
+
+    bool thrown = false;
+    try{
+        IVFPQIndex untrained(dims, 4, 6);
+        untrained.add(gallery);
+    }
+    catch(const runtime_error&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+int IndexTests(){
+
+    cout << "===== Running IVF-PQ Index Tests =====" << endl;
+
+    testKmeans();
+    testIndexSearch();
+
+    return 0;
+}
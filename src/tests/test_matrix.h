@@ -282,6 +282,46 @@ void testEigen(){
     assert(E_error <= 0.01);
 }
 
+void testEigenCallback(){
+    int data[] = {4, -30, 60, -35, -30, 300, -675, 420, 60, -675, 1620, -1050, -35, 420, -1050, 700};
+    Matrix<int> mat(4,4,data);
+
+    //the external backend solves directly and reports once, the intervals belong to the QR iterations
+    bool backend = Backend::enabled();
+    Backend::enabled() = false;
+
+    int calls = 0;
+    int lastIteration = 0;
+    float lastOffDiagonal = -1.0;
+    auto callback = [&](const EigenProgress& progress){
+        calls++;
+        lastIteration = progress.iteration;
+        lastOffDiagonal = progress.offDiagonal;
+        return true;
+    };
+
+    mat.eigen(105, callback, 10);
+
+    //every 10 iterations and once more for the last one
+    assert(calls == 11);
+    assert(lastIteration == 105);
+    //converged so the off-diagonal elements are negligible compared to the input (up to 1620)
+    assert(lastOffDiagonal < 1.0);
+
+    //stop after the second report
+    calls = 0;
+    mat.eigen(100, [&](const EigenProgress& progress){
+        calls++;
+        lastIteration = progress.iteration;
+        return progress.iteration < 20;
+    }, 10);
+
+    assert(calls == 2);
+    assert(lastIteration == 20);
+
+    Backend::enabled() = backend;
+}
+
 void testFlatten(){
     int data[] = {4, -30, 60, -35, -30, 300, -675, 420, 60, -675, 1620, -1050, -35, 420, -1050, 700};
     Matrix<int> mat(4,4,data);
@@ -310,6 +350,122 @@ void testSlice(){
 
 
 
+void testColMajor(){
+    int data[] = {1,2,3,4,5,6};
+    Matrix<int> rowMajor(2,3,data);
+    Matrix<int, ColMajor> colMajor = rowMajor.reorder<ColMajor>();
+
+    //same elements, columns are contiguous in memory
+    int memory[] = {1,4,2,5,3,6};
+    for(int i = 0; i<6; i++){
+        assert(colMajor[i] == memory[i]);
+    }
+    assert(colMajor(1,2) == 6);
+
+    auto column = colMajor.getColumn(1);
+    assert(column[0] == 2 && column[1] == 5);
+
+    int data2[] = {7, 8};
+    colMajor.setColumn(2, Matrix<int>(2,1,data2));
+    assert(colMajor(0,2) == 7 && colMajor(1,2) == 8);
+
+    auto slice = colMajor.slice(1, 3);
+    assert(slice(0,0) == 2 && slice(1,1) == 8);
+
+    auto back = colMajor.reorder<RowMajor>();
+    int result[] = {1,2,7,4,5,8};
+    for(int i = 0; i<6; i++){
+        assert(back[i] == result[i]);
+    }
+}
+
+void testMatMultMixedOrder(){
+    int data[] = {1,2,3,4,5,6};
+    Matrix<int> a(2,3,data);
+    Matrix<int> b = a.transpose();
+    auto aCol = a.reorder<ColMajor>();
+    auto bCol = b.reorder<ColMajor>();
+
+    //a * a^T = {14, 32, 32, 77} for every combination of storage orders
+    int result[] = {14, 32, 32, 77};
+    Matrix<int> products[] = {Matrix<int>::multMat(a, b), Matrix<int>::multMat(a, bCol),
+                              Matrix<int>::multMat(aCol, b), Matrix<int>::multMat(aCol, bCol),
+                              Matrix<int, ColMajor>::multMat(a, b).reorder<RowMajor>(),
+                              Matrix<int, ColMajor>::multMat(aCol, bCol).reorder<RowMajor>(),
+                              Matrix<int, ColMajor>::multMat(a, bCol).reorder<RowMajor>()};
+
+    for(auto& product : products){
+        for(int i = 0; i<4; i++){
+            assert(product[i] == result[i]);
+        }
+    }
+
+    auto transposed = aCol.transpose();
+    assert(transposed.M == 3 && transposed(2,1) == 6);
+}
+
+void testGramSchmidtColMajor(){
+    int data[] = {12, -51, 4, 6, 167, -68, -4, 24, -41};
+    Matrix<int> mat(3,3,data);
+    Matrix<float> rowMajor = mat.GramSchmidt();
+    Matrix<float> colMajor = mat.reorder<ColMajor>().GramSchmidt().reorder<RowMajor>();
+
+    for(int i = 0; i<9; i++){
+        assert(abs(rowMajor[i] - colMajor[i]) < 0.0001);
+    }
+}
+
+void testBlockedTranspose(){
+    //sizes that are not a multiple of the 8 by 8 tiles
+    Matrix<float> a(19, 13);
+    for(int i = 0; i<19*13; i++){
+        a[i] = float(i);
+    }
+    auto aCol = a.reorder<ColMajor>();
+
+    auto t = a.transpose();
+    auto tCol = aCol.transpose();
+    assert(t.M == 13 && t.N == 19 && tCol.M == 13 && tCol.N == 19);
+    for(int i = 0; i<19; i++){
+        for(int j = 0; j<13; j++){
+            assert(t(j,i) == a(i,j) && tCol(j,i) == a(i,j));
+        }
+    }
+
+    //square matrices swap tiles in place, other shapes get new storage
+    Matrix<int> square(17, 17);
+    for(int i = 0; i<17*17; i++){
+        square[i] = i;
+    }
+    square.transposeInPlace();
+    for(int i = 0; i<17; i++){
+        for(int j = 0; j<17; j++){
+            assert(square(i,j) == j * 17 + i);
+        }
+    }
+
+    a.transposeInPlace();
+    assert(a.M == 13 && a.N == 19 && a(12,18) == float(18*13 + 12));
+}
+
+void testTransposedView(){
+    int data[] = {1,2,3,4,5,6};
+    Matrix<int> a(2,3,data);
+
+    //the view shares the data of a
+    Matrix<int, ColMajor> view = a.transposedView();
+    assert(view.M == 3 && view.N == 2 && view.data == a.data);
+    assert(view(2,1) == 6 && view(0,1) == 4);
+
+    //a * a^T = {14, 32, 32, 77} without a transposed copy
+    int result[] = {14, 32, 32, 77};
+    auto product = a*a.transposedView();
+    auto productCol = a.reorder<ColMajor>()*a.reorder<ColMajor>().transposedView();
+    for(int i = 0; i<4; i++){
+        assert(product[i] == result[i] && productCol[i] == result[i]);
+    }
+}
+
 int MatrixTests(){
 
     cout << "===== Running Matrix Tests =====" << endl;
@@ -330,8 +486,14 @@ int MatrixTests(){
     testGramSchmidt();
     testQR();
     testEigen();
+    testEigenCallback();
     testFlatten();
     testSlice();
+    testColMajor();
+    testMatMultMixedOrder();
+    testGramSchmidtColMajor();
+    testBlockedTranspose();
+    testTransposedView();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../utils/memprofile.h"
+#include "../utils/matrix.h"
+#include "../utils/parallel.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+using namespace std;
+
+void testMemoryAccounting(){
+    MemoryProfile profile;
+    int load = profile.phase("load");
+    assert(profile.phase("load") == load && load != 0);
+
+    //allocations are charged to the innermost phase of the thread, frees to the phase that allocated
+    MemoryProfile::stack().push_back(load);
+    int charged = profile.allocated(1000);
+    MemoryProfile::stack().pop_back();
+    int other = profile.allocated(5000);
+    assert(charged == load && other == 0);
+
+    profile.released(1000, charged);
+    assert(profile.liveBytes == 5000 && profile.peakBytes == 6000 && profile.peakPhase == 0);
+    assert(profile.phases[load].liveBytes == 0 && profile.phases[load].peakBytes == 1000);
+    assert(profile.phases[load].highWaterBytes == 1000 && profile.phases[0].highWaterBytes == 6000);
+    assert(profile.phases[load].allocations == 1 && profile.phases[0].allocatedBytes == 5000);
+
+    //sizes are counted in power of two buckets
+    assert(MemoryProfile::bucket(1000) == 10 && MemoryProfile::bucket(1024) == 10 && MemoryProfile::bucket(1025) == 11);
+    assert(profile.histogram[10] == 1 && profile.histogram[13] == 1);
+
+    ostringstream out;
+    profile.report("test", out);
+    assert(out.str().find("peak 5.9 KB in (no phase)") != string::npos);
+    assert(out.str().find("<=1.0 KB: 1") != string::npos);
+
+    //the live bytes of earlier runs become the baseline
+    profile.reset();
+    assert(profile.peakBytes == 5000 && profile.phases[0].allocations == 0 && profile.histogram[13] == 0);
+    profile.released(5000, other);
+    assert(profile.liveBytes == 0);
+}
+
+void testStorageProfile(){
+    //the storage is charged to the phase that allocated it until its last owner releases it
+    MemoryProfile profile;
+    int load = profile.phase("load");
+    shared_ptr<float> shared;
+    {
+        MemoryProfile::stack().push_back(load);
+        shared_ptr<float> storage = profiledStorage<float>(250, profile);
+        MemoryProfile::stack().pop_back();
+        assert(storage.get()[249] == 0.0f);
+        assert(profile.liveBytes == 1000 && profile.phases[load].liveBytes == 1000);
+
+        shared = storage;
+        shared_ptr<double> other = profiledStorage<double>(10, profile);
+        assert(profile.liveBytes == 1080 && profile.phases[0].liveBytes == 80);
+    }
+    assert(profile.liveBytes == 1000 && profile.phases[0].liveBytes == 0);
+
+    //freed outside of the phase, credited back to it
+    shared.reset();
+    assert(profile.liveBytes == 0 && profile.phases[load].liveBytes == 0);
+    assert(profile.peakBytes == 1080 && profile.phases[load].allocations == 1 && profile.phases[0].allocations == 1);
+}
+
+void testMatrixStorageProfile(){
+#ifdef MEMPROFILE
+    MemoryProfile& profile = MemoryProfile::instance();
+    int64_t before = profile.liveBytes;
+    {
+        MEMORY_PHASE("matrix test");
+        int index = MemoryProfile::current();
+        uint64_t allocations = profile.phases[index].allocations;
+        Matrix<float> a(100, 10);
+        assert(profile.liveBytes == before + 4000);
+        assert(profile.phases[index].allocations == allocations + 1);
+    }
+    assert(profile.liveBytes == before);
+
+    //the workers of a loop allocate on behalf of the phase that submitted it
+    ThreadPool pool(3, false);
+    uint64_t unphased = profile.phases[0].allocations;
+    {
+        MEMORY_PHASE("pool test");
+        int index = MemoryProfile::current();
+        uint64_t allocations = profile.phases[index].allocations;
+        pool.run(64, 1, [](int, int){
+            Matrix<float> chunk(4, 4);
+        });
+        assert(profile.phases[index].allocations == allocations + 64);
+    }
+    assert(profile.phases[0].allocations == unphased);
+#endif
+}
+
+int MemoryProfileTests(){
+
+    cout << "===== Running Memory Profile Tests =====" << endl;
+
+    testMemoryAccounting();
+    testStorageProfile();
+    testMatrixStorageProfile();
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../utils/parallel.h"
+#include "../utils/matrix.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+using namespace std;
+
+void testParallelForCoversRange(){
+    Parallel::configure(3);
+
+    for(int size : {1, 100, 100000}){
+        vector<int> visits(size, 0);
+        parallelFor(size, 1, [&](int begin, int end){
+            for(int i = begin; i<end; i++){
+                visits[i]++;
+            }
+        });
+
+        for(int i = 0; i<size; i++){
+            assert(visits[i] == 1);
+        }
+    }
+}
+
+void testParallelMatrixOps(){
+    Parallel::configure(4);
+    int previousGrain = Parallel::grain();
+    Parallel::grain() = 16;
+
+    //skinny and wide matrices are split by elements, not only by rows
+    Matrix<float> column(1000, 1);
+    Matrix<float> row(1, 1000);
+    for(int i = 0; i<1000; i++){
+        column[i] = i;
+        row[i] = 1;
+    }
+
+    auto sum = column + column;
+    auto product = Matrix<float>::multMat(row, column);
+    auto transposed = column.transpose();
+
+    for(int i = 0; i<1000; i++){
+        assert(sum[i] == 2 * i);
+        assert(transposed[i] == i);
+    }
+    assert(product[0] == 499500);
+
+    Parallel::grain() = previousGrain;
+    Parallel::configure(omp_get_max_threads());
+}
+
+int ParallelTests(){
+
+    cout << "===== Running Parallel Tests =====" << endl;
+
+    testParallelForCoversRange();
+    testParallelMatrixOps();
+
+    return 0;
+}
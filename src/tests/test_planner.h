@@ -0,0 +1,237 @@
+#pragma once
+
+#include "../utils/planner.h"
+#include "../utils/pca.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+void testPlanChoice(){
+    TrainingBudget budget;
+    budget.cores = 4;
+
+    //few faces with many pixels and a short eigendecomposition: the images by images problem is the cheapest
+    auto plan = planTraining(1400, 205, 100, 10, budget);
+    assert(plan.estimates.size() == 3);
+    assert(plan.best().strategy == GramMatrix && plan.best().fits);
+    assert(plan.estimates[FullCovariance].bytes > plan.estimates[GramMatrix].bytes);
+
+    //with 50000 QR iterations the built-in eigendecomposition of even 205 by 205 costs more than a subspace iteration
+    plan = planTraining(1400, 205, 100, 50000, budget);
+    assert(plan.best().strategy == (Backend::active() ? GramMatrix : IterativeTopK));
+
+    //many faces and a small k: only the k leading vectors are worth computing
+    plan = planTraining(1400, 5000, 4, 50000, budget);
+    assert(plan.best().strategy == IterativeTopK);
+
+    //the pixels by pixels matrices do not fit into 10 MB
+    budget.memoryBytes = 10 << 20;
+    plan = planTraining(1400, 205, 100, 50000, budget);
+    assert(!plan.estimates[FullCovariance].fits && plan.estimates[FullCovariance].reason.find("needs") == 0);
+
+    //more eigenvectors than faces is only possible with the full covariance
+    budget.memoryBytes = double(1 << 30);
+    plan = planTraining(100, 20, 50, 10, budget);
+    assert(plan.best().strategy == FullCovariance && !plan.estimates[GramMatrix].fits);
+
+    bool thrown = false;
+    budget.memoryBytes = 1024;
+    try{
+        planTraining(1400, 205, 100, 50000, budget);
+    }
+    catch(const runtime_error&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testStrategiesAgree(){
+    //fewer faces than pixels like the ORL faces, around a mean with three dominant directions of different variance
+    const int rows = 6;
+    const int cols = 5;
+    const int pixels = rows * cols;
+    mt19937 generator(5);
+    normal_distribution<float> distribution(0.0, 1.0);
+
+    vector<vector<float>> directions(3, vector<float>(pixels));
+    for(auto& direction : directions){
+        for(auto& value : direction){
+            value = distribution(generator);
+        }
+    }
+
+    vector<Image> trainData;
+    for(int i = 0; i<20; i++){
+        std::shared_ptr<Matrix<float>> face(new Matrix<float>(rows, cols));
+        float a = 40.0f * distribution(generator);
+        float b = 15.0f * distribution(generator);
+        float c = 5.0f * distribution(generator);
+        for(int p = 0; p<pixels; p++){
+            face->operator[](p) = 100.0f + a * directions[0][p] + b * directions[1][p] + c * directions[2][p]
+                                  + distribution(generator);
+        }
+        trainData.push_back(Image(to_string(i), 0, face));
+    }
+
+    TrainingBudget budget;
+    budget.sweeps = 50;
+    const int k = 3;
+    auto gram = TrainWith(trainData, GramMatrix, k, budget, false, 3000);
+    auto iterative = TrainWith(trainData, IterativeTopK, k, budget, false, 3000);
+
+    auto mean = meanFace(trainData);
+    auto A = faceMatrix(trainData, mean);
+    auto C = Matrix<float, ColMajor>::multTransposed(A);
+
+    float previous = numeric_limits<float>::max();
+    for(int c = 0; c<k; c++){
+        //unit eigenvectors of C with descending eigenvalues, the same up to the sign for both strategies
+        float dot = 0.0;
+        float norm = 0.0;
+        for(int p = 0; p<pixels; p++){
+            dot += gram(p, c) * iterative(p, c);
+            norm += gram(p, c) * gram(p, c);
+        }
+        assert(fabs(fabs(dot) - 1.0) < 1e-3);
+        assert(fabs(norm - 1.0) < 1e-3);
+
+        vector<float> Cv(pixels, 0.0);
+        float value = 0.0;
+        for(int i = 0; i<pixels; i++){
+            for(int j = 0; j<pixels; j++){
+                Cv[i] += C(i, j) * gram(j, c);
+            }
+            value += gram(i, c) * Cv[i];
+        }
+        float residual = 0.0;
+        for(int i = 0; i<pixels; i++){
+            residual += (Cv[i] - value * gram(i, c)) * (Cv[i] - value * gram(i, c));
+        }
+        assert(sqrt(residual) < 1e-3 * value);
+        assert(value < previous);
+        previous = value;
+    }
+}
+
+void testVarianceTarget(){
+    //faces with a geometrically decaying spectrum, so every target needs a different k
+    const int pixels = 48;
+    const int faces = 40;
+    mt19937 generator(9);
+    normal_distribution<float> distribution(0.0, 1.0);
+
+    vector<vector<float>> directions(24, vector<float>(pixels));
+    for(auto& direction : directions){
+        for(auto& value : direction){
+            value = distribution(generator);
+        }
+    }
+
+    vector<Image> trainData;
+    for(int i = 0; i<faces; i++){
+        std::shared_ptr<Matrix<float>> face(new Matrix<float>(8, 6));
+        for(int p = 0; p<pixels; p++){
+            face->operator[](p) = 100.0f;
+        }
+        for(int d = 0; d<directions.size(); d++){
+            float weight = 30.0f * pow(0.8f, d) * distribution(generator);
+            for(int p = 0; p<pixels; p++){
+                face->operator[](p) += weight * directions[d][p];
+            }
+        }
+        trainData.push_back(Image(to_string(i), 0, face));
+    }
+
+    //the exact spectrum of the covariance
+    auto mean = meanFace(trainData);
+    auto A = faceMatrix(trainData, mean);
+    auto C = Matrix<float, ColMajor>::multTransposed(A);
+    auto exact = get<1>(leadingEigenvectors(C, 3000, pixels));
+    double total = 0.0;
+    for(float value : exact){
+        total += max(value, 0.0f);
+    }
+
+    TrainingBudget budget;
+    budget.sweeps = 50;
+    int previousK = 0;
+    for(float target : {0.5f, 0.9f, 0.99f}){
+        int exactK = 0;
+        double explained = 0.0;
+        while(explained < target * total){
+            explained += exact[exactK++];
+        }
+
+        //blocks of 4 so the larger targets need several blocks
+        auto decomposition = varianceEigenvectors(A, target, budget, 4);
+        auto values = get<1>(decomposition);
+        assert(fabs(get<2>(decomposition) - total) < 1e-3 * total);
+        assert((values.size() >= exactK) && (values.size() <= exactK + 1));
+        for(int c = 0; c<values.size(); c++){
+            assert(fabs(values[c] - exact[c]) < 1e-2 * exact[0]);
+            assert((c == 0) || (values[c] <= values[c - 1]));
+        }
+
+        auto training = TrainToVariance(trainData, target, budget);
+        assert(training.k == values.size() && training.Vk.N == training.k && training.Vk.M == pixels);
+        assert(training.explainedVariance >= target && training.explainedVariance <= 1.0f);
+        assert(training.k > previousK);
+        previousK = training.k;
+    }
+
+    bool thrown = false;
+    try{
+        TrainToVariance(trainData, 1.5f);
+    }
+    catch(const domain_error&){
+        thrown = true;
+    }
+    assert(thrown);
+
+    //a cached decomposition whose eigenvalues are not in descending order
+    TrainingArtifacts artifacts;
+    artifacts.key = trainingKey(trainData, 50000);
+    artifacts.mean = mean;
+    artifacts.values = Matrix<float, ColMajor>(pixels, 1);
+    artifacts.basis = Matrix<float, ColMajor>(pixels, pixels);
+    for(int i = 0; i<pixels; i++){
+        artifacts.values[i] = (i == 3) ? 60.0f : ((i == 7) ? 30.0f : 1.0f);
+        artifacts.basis[i * pixels + i] = 1.0f;
+    }
+    TrainingCache cache("test_variance_cache");
+    cache.store(artifacts);
+    auto cached = TrainToVariance(trainData, 0.65f, budget, false, 50000, &cache);
+    assert(cache.hits == 1 && cached.k == 2);
+    assert(cached.values[0] == 60.0f && cached.values[1] == 30.0f);
+    assert(cached.Vk(3, 0) == 1.0f && cached.Vk(7, 1) == 1.0f);
+    remove(cache.path(artifacts.key).c_str());
+    rmdir(cache.directory.c_str());
+
+    //identical faces have no variance to explain
+    vector<Image> identical(4, trainData[0]);
+    thrown = false;
+    try{
+        TrainToVariance(identical, 0.9f);
+    }
+    catch(const domain_error& e){
+        thrown = (string(e.what()) == "the training faces have no variance");
+    }
+    assert(thrown);
+}
+
+int PlannerTests(){
+
+    cout << "===== Running Planner Tests =====" << endl;
+
+    testPlanChoice();
+    testStrategiesAgree();
+    testVarianceTarget();
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "../utils/recognizer.h"
+#include "../utils/pca.h"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+vector<Image> randomGallery(int faces, int rows, int cols, int seed){
+    mt19937 generator(seed);
+    uniform_real_distribution<float> pixel(0.0, 255.0);
+
+    vector<Image> gallery;
+    for(int i = 0; i<faces; i++){
+        std::shared_ptr<Matrix<float>> face(new Matrix<float>(rows, cols));
+        for(int p = 0; p<rows * cols; p++){
+            face->operator[](p) = pixel(generator);
+        }
+        gallery.push_back(Image(to_string(i), 0, face));
+    }
+    return gallery;
+}
+
+/*
+@brief copy of a model with a new version, every label names the version so a query can check that the label and the
+version it got come from the same model
+*/
+unique_ptr<RecognitionModel> versionedModel(const RecognitionModel& base, int version){
+    unique_ptr<RecognitionModel> model(new RecognitionModel(base));
+    model->version = version;
+    for(auto& label : model->labels){
+        label = "v" + to_string(version);
+    }
+    return model;
+}
+
+void testRecognizerMatches(){
+    auto gallery = randomGallery(12, 8, 6, 1);
+    auto Vk = Train(gallery, 8, false, 100);
+    Recognizer recognizer(RecognitionModel::build(gallery, Vk, 1));
+
+    //every gallery face is its own closest face
+    for(int i = 0; i<gallery.size(); i++){
+        auto result = recognizer.recognize(gallery[i]);
+        assert(result.index == i && result.label == to_string(i) && result.version == 1);
+    }
+}
+
+void testRecognizerHotSwap(){
+    auto gallery = randomGallery(20, 8, 6, 2);
+    auto Vk = Train(gallery, 8, false, 100);
+    auto base = RecognitionModel::build(gallery, Vk, 0);
+    Recognizer recognizer(versionedModel(*base, 0));
+
+    const int swaps = 300;
+    atomic<bool> done(false);
+    atomic<int> queries(0);
+    atomic<int> mismatches(0);
+    vector<thread> readers;
+
+    for(int t = 0; t<3; t++){
+        readers.emplace_back([&, t](){
+            int last = 0;
+            for(int i = t; !done.load() || (i < t + 10); i++){
+                auto result = recognizer.recognize(gallery[i % gallery.size()]);
+                //a consistent model, and versions never go back within one thread
+                if((result.label != "v" + to_string(result.version)) || (result.index != i % gallery.size()) || (result.version < last)){
+                    mismatches++;
+                }
+                last = result.version;
+                queries++;
+            }
+        });
+    }
+
+    for(int v = 1; v<=swaps; v++){
+        recognizer.publish(versionedModel(*base, v));
+        if(v % 50 == 0){
+            this_thread::yield();
+        }
+    }
+    done = true;
+    for(auto& reader : readers){
+        reader.join();
+    }
+
+    assert(mismatches == 0);
+    assert(queries >= 30);
+    assert(recognizer.version() == swaps);
+
+    //without readers every old model can be freed
+    assert(recognizer.domain.collect() == 0);
+    assert(recognizer.domain.reclaimed == swaps);
+}
+
+void testIdentityPrototypes(){
+    //two identities on a line, the second one has an outlier
+    Matrix<float> weights(7, 1);
+    vector<float> values = {0.0, 1.0, 2.0, 10.0, 11.0, 12.0, 30.0};
+    vector<string> labels = {"a", "a", "a", "b", "b", "b", "b"};
+    copy(values.begin(), values.end(), weights.data.get());
+
+    auto centroids = IdentityPrototypes::build(weights, labels, 1);
+    assert((centroids.identities == vector<string>{"a", "b"}));
+    assert((centroids.members[1] == vector<int>{3, 4, 5, 6}));
+    assert(centroids.prototypes.M == 2 && centroids.owner[1] == 1);
+    assert(centroids.prototypes(0, 0) == 1.0f && centroids.prototypes(1, 0) == 15.75f);
+
+    //medoids are gallery faces, the outlier gets its own prototype
+    auto medoids = IdentityPrototypes::build(weights, labels, 2);
+    assert(medoids.prototypes.M == 4);
+    for(int p = 0; p<medoids.prototypes.M; p++){
+        assert(find(values.begin(), values.end(), medoids.prototypes(p, 0)) != values.end());
+    }
+    bool outlier = false;
+    for(int p = 0; p<medoids.prototypes.M; p++){
+        outlier |= (medoids.prototypes(p, 0) == 30.0f) && (medoids.owner[p] == 1);
+    }
+    assert(outlier);
+
+    try{
+        IdentityPrototypes::build(weights, labels, 0);
+        assert(false);
+    }
+    catch(const domain_error&){}
+}
+
+void testPrototypeSearch(){
+    //three images per subject, the prototypes rank the subjects before their images are compared
+    auto gallery = randomGallery(18, 8, 6, 3);
+    for(int i = 0; i<gallery.size(); i++){
+        gallery[i].name = to_string(i / 3);
+    }
+    auto Vk = Train(gallery, 8, false, 100);
+    auto model = RecognitionModel::build(gallery, Vk, 1, 2);
+    assert(model->prototypes.identities.size() == 6);
+
+    for(int i = 0; i<gallery.size(); i++){
+        auto w = model->project(gallery[i]);
+        auto exact = model->search(w.data(), 0);
+        assert(exact.index == i && exact.distance < 1e-3);
+
+        //with every identity shortlisted the search is exact, a shorter list can only find a farther face
+        auto all = model->search(w.data(), 6);
+        assert(all.index == exact.index);
+        auto shortlisted = model->search(w.data(), 2);
+        assert((shortlisted.distance >= exact.distance) && (shortlisted.version == 1));
+    }
+
+    //k and the explained variance of a variance target stay with the model
+    auto training = TrainToVariance(gallery, 0.9f);
+    auto explained = RecognitionModel::build(gallery, training, 2);
+    assert(explained->basis.N == training.k && explained->explainedVariance == training.explainedVariance);
+
+    //8-bit probes find the same faces as their float copies
+    vector<vector<uint8_t>> bytes;
+    vector<const uint8_t*> pointers;
+    for(int i = 0; i<5; i++){
+        bytes.push_back(vector<uint8_t>(48));
+        for(int p = 0; p<48; p++){
+            bytes[i][p] = uint8_t(gallery[i].data->operator[](p));
+        }
+    }
+    for(const auto& face : bytes){
+        pointers.push_back(face.data());
+    }
+    auto weights = explained->projectBytes(pointers);
+    for(int i = 0; i<5; i++){
+        std::shared_ptr<Matrix<float>> face(new Matrix<float>(8, 6));
+        copy(bytes[i].begin(), bytes[i].end(), face->data.get());
+        auto w = explained->project(Image("probe", 0, face));
+        for(int c = 0; c<w.size(); c++){
+            assert(fabs(weights(i, c) - w[c]) < 1e-3f * max(1.0f, fabs(w[c])));
+        }
+    }
+
+    //the recognizer passes the shortlist through
+    Recognizer recognizer(move(model));
+    assert(recognizer.recognize(gallery[4], 6).index == 4);
+    auto batch = recognizer.recognizeBytes(pointers, 6);
+    assert(batch.size() == 5 && batch[3].version == 1);
+}
+
+int RecognizerTests(){
+
+    cout << "===== Running Recognizer Tests =====" << endl;
+
+    testRecognizerMatches();
+    testRecognizerHotSwap();
+    testIdentityPrototypes();
+    testPrototypeSearch();
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../utils/shard.h"
+#include "../utils/pca.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void testShardedCovarianceMatchesTrain(){
+    auto paths = trainingPaths(0.5);
+    paths.resize(20);
+
+    //the single process reference as computed by Train
+    vector<Image> images;
+    for(const auto& path : paths){
+        images.push_back(Image(path.c_str(), 8));
+    }
+    Matrix<float> mean = meanFace(images);
+    Matrix<float, ColMajor> A = faceMatrix(images, mean);
+    Matrix<float, ColMajor> C = Matrix<float, ColMajor>::multTransposed(A);
+
+    //uneven slices, a single worker and more workers than images
+    for(int workers : {3, 1, 32}){
+        auto sharded = shardedCovariance(paths, 8, workers);
+        assert(sharded.count == 20);
+        assert(sharded.covariance.M == C.M && sharded.covariance.N == C.N);
+
+        for(int i = 0; i<mean.M; i++){
+            assert(fabs(sharded.mean[i] - mean[i]) < 1e-3);
+        }
+        for(int i = 0; i<C.M*C.N; i++){
+            assert(fabs(sharded.covariance[i] - C[i]) < 1e-4 * (fabs(C[i]) + 100.0));
+        }
+    }
+}
+
+void testShardedCovarianceWorkerFailure(){
+    vector<string> paths = {"../images/archive/1_1.jpg", "../images/archive/2_1.jpg", "../images/archive/missing.jpg",
+                            "../images/archive/3_1.jpg"};
+
+    bool thrown = false;
+    try{
+        shardedCovariance(paths, 8, 4);
+    }
+    catch(const runtime_error&){
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testShardedCovarianceForeignChild(){
+    auto paths = trainingPaths(0.5);
+    paths.resize(8);
+    auto expected = shardedCovariance(paths, 8, 2);
+
+    //another child of the program that fails while the workers run is neither reaped nor taken for a worker
+    pid_t other = fork();
+    assert(other >= 0);
+    if(other == 0){
+        _exit(3);
+    }
+
+    auto sharded = shardedCovariance(paths, 8, 2);
+    for(int i = 0; i<expected.covariance.M * expected.covariance.N; i++){
+        assert(sharded.covariance[i] == expected.covariance[i]);
+    }
+
+    int status = 0;
+    assert(waitpid(other, &status, 0) == other);
+    assert(WIFEXITED(status) && (WEXITSTATUS(status) == 3));
+}
+
+int ShardTests(){
+
+    cout << "===== Running Shard Tests =====" << endl;
+
+    testShardedCovarianceMatchesTrain();
+    testShardedCovarianceWorkerFailure();
+    testShardedCovarianceForeignChild();
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/*
+Optional external BLAS/LAPACK backend (OpenBLAS, MKL, reference LAPACK, ...), compiled in with cmake -DUSE_BLAS=ON.
+The float kernels of Matrix first offer their work to the functions below and use the built-in loops when they return
+false, which they always do for other types, for builds without the backend and when it is switched off at runtime.
+
+The Fortran interface is declared directly so only the libraries are needed, no cblas or lapacke headers. All of them
+read and write column-major arrays, a row-major matrix is passed as its transpose.
+*/
+#ifdef USE_BLAS
+extern "C" {
+void sgemm_(const char* transa, const char* transb, const int* m, const int* n, const int* k, const float* alpha,
+            const float* a, const int* lda, const float* b, const int* ldb, const float* beta, float* c, const int* ldc);
+void ssyrk_(const char* uplo, const char* trans, const int* n, const int* k, const float* alpha, const float* a,
+            const int* lda, const float* beta, float* c, const int* ldc);
+void sgeqrf_(const int* m, const int* n, float* a, const int* lda, float* tau, float* work, const int* lwork, int* info);
+void sorgqr_(const int* m, const int* n, const int* k, float* a, const int* lda, const float* tau, float* work,
+             const int* lwork, int* info);
+void ssyevr_(const char* jobz, const char* range, const char* uplo, const int* n, float* a, const int* lda,
+             const float* vl, const float* vu, const int* il, const int* iu, const float* abstol, int* m, float* w,
+             float* z, const int* ldz, int* isuppz, float* work, const int* lwork, int* iwork, const int* liwork, int* info);
+}
+#endif
+
+/*
+@brief selects the backend of the float kernels
+*/
+struct Backend {
+
+  /*
+  @brief true if the program was built with the external backend
+  */
+  static bool compiled(){
+#ifdef USE_BLAS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /*
+  @brief switch the external backend on or off at runtime (on by default), e.g. to compare it with the built-in kernels
+  */
+  static bool& enabled(){
+    static bool e = true;
+    return e;
+  }
+
+  /*
+  @brief true if the kernels currently use the external backend
+  */
+  static bool active(){
+    return compiled() && enabled();
+  }
+
+  static const char* name(){
+    return active() ? "blas" : "native";
+  }
+};
+
+/*
+@brief C = op(A) * op(B) for column-major arrays, op transposes the operand if the flag is set
+@param transA use A^T
+@param transB use B^T
+@param m rows of C
+@param n columns of C
+@param k inner dimension
+@param a array of A with leading dimension lda
+@param b array of B with leading dimension ldb
+@param c array of C with leading dimension ldc
+@returns true if the product was computed by the backend
+*/
+template<typename T>
+bool blasGemm(bool transA, bool transB, int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc){
+  return false;
+}
+
+/*
+@brief C = A * A^T (or A^T * A if trans is set) for a column-major A, both triangles of C are filled
+@param trans use A^T * A
+@param n rows and columns of C
+@param k inner dimension
+@param a array of A with leading dimension lda
+@param c array of C (n by n)
+@returns true if the product was computed by the backend
+*/
+template<typename T>
+bool blasSyrk(bool trans, int n, int k, const T* a, int lda, T* c){
+  return false;
+}
+
+/*
+@brief QR decomposition of a column-major m by n array (m >= n). The signs are chosen so that the diagonal of R is
+positive, which makes the result the same as the one of Gram-Schmidt
+@param m rows
+@param n columns
+@param a the matrix, replaced by Q (m by n)
+@param r array for R (n by n)
+@returns true if the decomposition was computed by the backend
+*/
+template<typename T>
+bool blasQR(int m, int n, T* a, T* r){
+  return false;
+}
+
+/*
+@brief eigenvalues and eigenvectors of a symmetric column-major n by n array, sorted by descending eigenvalue
+@param n rows and columns
+@param a the matrix (destroyed)
+@param values array for the n eigenvalues
+@param vectors array for the eigenvectors (n by n, one per column)
+@returns true if the decomposition was computed by the backend, false if it is disabled or a is not symmetric
+*/
+template<typename T>
+bool blasSymmetricEigen(int n, T* a, T* values, T* vectors){
+  return false;
+}
+
+#ifdef USE_BLAS
+inline bool blasGemm(bool transA, bool transB, int m, int n, int k, const float* a, int lda, const float* b, int ldb, float* c, int ldc){
+  if(!Backend::enabled() || (m == 0) || (n == 0)){
+    return false;
+  }
+
+  char ta = transA ? 'T' : 'N';
+  char tb = transB ? 'T' : 'N';
+  float alpha = 1.0;
+  float beta = 0.0;
+  lda = max(lda, 1);
+  ldb = max(ldb, 1);
+  ldc = max(ldc, 1);
+  sgemm_(&ta, &tb, &m, &n, &k, &alpha, a, &lda, b, &ldb, &beta, c, &ldc);
+  return true;
+}
+
+inline bool blasSyrk(bool trans, int n, int k, const float* a, int lda, float* c){
+  if(!Backend::enabled() || (n == 0)){
+    return false;
+  }
+
+  char uplo = 'U';
+  char t = trans ? 'T' : 'N';
+  float alpha = 1.0;
+  float beta = 0.0;
+  lda = max(lda, 1);
+  ssyrk_(&uplo, &t, &n, &k, &alpha, a, &lda, &beta, c, &n);
+
+  //only the upper triangle is written
+  for(int j = 0; j<n; j++){
+    for(int i = 0; i<j; i++){
+      c[j + i * n] = c[i + j * n];
+    }
+  }
+  return true;
+}
+
+inline bool blasQR(int m, int n, float* a, float* r){
+  if(!Backend::enabled() || (m < n) || (n == 0)){
+    return false;
+  }
+
+  vector<float> tau(n);
+  int info = 0;
+  int lwork = -1;
+  float query = 0.0;
+
+  sgeqrf_(&m, &n, a, &m, tau.data(), &query, &lwork, &info);
+  lwork = max(int(query), n);
+  vector<float> work(lwork);
+  sgeqrf_(&m, &n, a, &m, tau.data(), work.data(), &lwork, &info);
+  if(info != 0){
+    throw runtime_error("sgeqrf failed");
+  }
+
+  //R is the upper triangle of the factored array
+  for(int j = 0; j<n; j++){
+    for(int i = 0; i<n; i++){
+      r[i + j * n] = (i <= j) ? a[i + j * m] : 0.0f;
+    }
+  }
+
+  lwork = -1;
+  sorgqr_(&m, &n, &n, a, &m, tau.data(), &query, &lwork, &info);
+  lwork = max(int(query), n);
+  work.resize(lwork);
+  sorgqr_(&m, &n, &n, a, &m, tau.data(), work.data(), &lwork, &info);
+  if(info != 0){
+    throw runtime_error("sorgqr failed");
+  }
+
+  //flip the Householder signs so that R has a positive diagonal like Gram-Schmidt
+  for(int j = 0; j<n; j++){
+    if(r[j + j * n] < 0.0f){
+      for(int c = j; c<n; c++){
+        r[j + c * n] = -r[j + c * n];
+      }
+      for(int i = 0; i<m; i++){
+        a[i + j * m] = -a[i + j * m];
+      }
+    }
+  }
+  return true;
+}
+
+inline bool blasSymmetricEigen(int n, float* a, float* values, float* vectors){
+  if(!Backend::enabled() || (n == 0)){
+    return false;
+  }
+
+  for(int j = 0; j<n; j++){
+    for(int i = 0; i<j; i++){
+      float upper = a[i + j * n];
+      float lower = a[j + i * n];
+      if(fabs(upper - lower) > 1e-5f * (fabs(upper) + fabs(lower)) + 1e-30f){
+        return false;
+      }
+    }
+  }
+
+  char jobz = 'V';
+  char range = 'A';
+  char uplo = 'U';
+  float vl = 0.0;
+  float vu = 0.0;
+  int il = 0;
+  int iu = 0;
+  float abstol = 0.0;
+  int found = 0;
+  int info = 0;
+  vector<float> w(n);
+  vector<float> z(n * n);
+  vector<int> isuppz(2 * n);
+
+  int lwork = -1;
+  int liwork = -1;
+  float workQuery = 0.0;
+  int iworkQuery = 0;
+  ssyevr_(&jobz, &range, &uplo, &n, a, &n, &vl, &vu, &il, &iu, &abstol, &found, w.data(), z.data(), &n, isuppz.data(),
+          &workQuery, &lwork, &iworkQuery, &liwork, &info);
+
+  lwork = max(int(workQuery), 26 * n);
+  liwork = max(iworkQuery, 10 * n);
+  vector<float> work(lwork);
+  vector<int> iwork(liwork);
+  ssyevr_(&jobz, &range, &uplo, &n, a, &n, &vl, &vu, &il, &iu, &abstol, &found, w.data(), z.data(), &n, isuppz.data(),
+          work.data(), &lwork, iwork.data(), &liwork, &info);
+  if((info != 0) || (found != n)){
+    throw runtime_error("ssyevr failed");
+  }
+
+  //LAPACK sorts ascending, the eigenfaces use the largest eigenvalues first
+  for(int j = 0; j<n; j++){
+    values[j] = w[n - 1 - j];
+    copy(z.begin() + (n - 1 - j) * n, z.begin() + (n - j) * n, vectors + j * n);
+  }
+  return true;
+}
+#endif
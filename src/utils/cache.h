@@ -0,0 +1,239 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "matrix.h"
+#include "image.h"
+#include "blas.h"
+
+using namespace std;
+
+/*
+@brief everything the eigendecomposition of one training set produces, independent of k
+@param key content key of the training set and parameters (see trainingKey)
+@param mean the average face (pixels by 1)
+@param values eigenvalues (pixels by 1)
+@param basis all eigenvectors (pixels by pixels, column-major so every k is a contiguous prefix)
+*/
+struct TrainingArtifacts {
+    uint64_t key = 0;
+    Matrix<float> mean = Matrix<float>(1, 1);
+    Matrix<float, ColMajor> values = Matrix<float, ColMajor>(1, 1);
+    Matrix<float, ColMajor> basis = Matrix<float, ColMajor>(1, 1);
+};
+
+/*
+@brief FNV-1a hash of the pixels of every training image and of the parameters that change the decomposition. The split
+and pooling factor are part of the pixels, k is not part of the key because every k is a slice of the same basis
+@param trainData the training images
+@param iterations amount of QR iterations of the eigendecomposition
+@returns 64 bit key
+*/
+uint64_t trainingKey(const vector<Image>& trainData, int iterations){
+    uint64_t hash = 14695981039346656037ULL;
+
+    auto add = [&hash](const void* data, size_t size){
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for(size_t i = 0; i<size; i++){
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    int count = trainData.size();
+    add(&count, sizeof(count));
+    for(const auto& image : trainData){
+        add(&image.data->M, sizeof(image.data->M));
+        add(&image.data->N, sizeof(image.data->N));
+        add(image.data->data.get(), sizeof(float) * image.data->M * image.data->N);
+    }
+
+    //the backends converge to the same basis up to rounding, but a cached result should be exactly reproducible
+    string backend = Backend::name();
+    add(&iterations, sizeof(iterations));
+    add(backend.data(), backend.size());
+
+    return hash;
+}
+
+/*
+@brief on-disk cache of training artifacts, one file per key. Files are written next to their final name and renamed,
+so readers never see a partial entry. A hit refreshes the modification time of the entry and the least recently used
+entries are removed when the directory grows beyond maxBytes. Lookups and stores can be called from several threads
+@param directory directory of the cache files (created if missing)
+@param maxBytes upper bound of the total size of all entries (1 GB by default)
+*/
+struct TrainingCache {
+    string directory;
+    uint64_t maxBytes;
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+    mutex m;
+
+    TrainingCache(const string& directory, uint64_t maxBytes = 1ULL << 30) : directory(directory), maxBytes(maxBytes) {
+        mkdir(directory.c_str(), 0755);
+    }
+
+    string path(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.eig", (unsigned long long)key);
+        return directory + "/" + name;
+    }
+
+    /*
+    @brief read the artifacts of a key
+    @param key the key of the training set
+    @param artifacts the artifacts that are read
+    @returns true on a hit
+    */
+    bool lookup(uint64_t key, TrainingArtifacts& artifacts){
+        lock_guard<mutex> lock(m);
+        string file = path(key);
+
+        if(!read(file, key, artifacts)){
+            misses++;
+            return false;
+        }
+
+        //mark as recently used
+        utimes(file.c_str(), nullptr);
+        hits++;
+        return true;
+    }
+
+    /*
+    @brief write the artifacts of a key and evict the least recently used entries if the cache is too large
+    @param artifacts the artifacts to store
+    */
+    void store(const TrainingArtifacts& artifacts){
+        lock_guard<mutex> lock(m);
+        string file = path(artifacts.key);
+        string temporary = file + ".tmp" + to_string(getpid());
+
+        {
+            ofstream out(temporary, ios::binary | ios::trunc);
+            if(!out){
+                throw runtime_error("could not write cache entry " + temporary);
+            }
+
+            int pixels = artifacts.mean.M;
+            out.write("EFC1", 4);
+            out.write(reinterpret_cast<const char*>(&artifacts.key), sizeof(artifacts.key));
+            out.write(reinterpret_cast<const char*>(&pixels), sizeof(pixels));
+            out.write(reinterpret_cast<const char*>(artifacts.mean.data.get()), sizeof(float) * pixels);
+            out.write(reinterpret_cast<const char*>(artifacts.values.data.get()), sizeof(float) * pixels);
+            out.write(reinterpret_cast<const char*>(artifacts.basis.data.get()), sizeof(float) * pixels * pixels);
+            if(!out){
+                throw runtime_error("could not write cache entry " + temporary);
+            }
+        }
+
+        if(rename(temporary.c_str(), file.c_str()) != 0){
+            remove(temporary.c_str());
+            throw runtime_error("could not move cache entry to " + file);
+        }
+
+        evict(file);
+    }
+
+    /*
+    @brief print the amount of hits, misses and evictions
+    */
+    void report(ostream& out = cout){
+        lock_guard<mutex> lock(m);
+        out << "===== Training cache " << directory << ": " << hits << " hits, " << misses << " misses, "
+            << evictions << " evictions =====" << endl;
+    }
+
+    static bool read(const string& file, uint64_t key, TrainingArtifacts& artifacts){
+        ifstream in(file, ios::binary);
+        if(!in){
+            return false;
+        }
+
+        char magic[4];
+        uint64_t storedKey = 0;
+        int pixels = 0;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+        in.read(reinterpret_cast<char*>(&pixels), sizeof(pixels));
+
+        if(!in || (memcmp(magic, "EFC1", 4) != 0) || (storedKey != key) || (pixels <= 0)){
+            return false;
+        }
+
+        artifacts.key = key;
+        artifacts.mean = Matrix<float>(pixels, 1);
+        artifacts.values = Matrix<float, ColMajor>(pixels, 1);
+        artifacts.basis = Matrix<float, ColMajor>(pixels, pixels);
+        in.read(reinterpret_cast<char*>(artifacts.mean.data.get()), sizeof(float) * pixels);
+        in.read(reinterpret_cast<char*>(artifacts.values.data.get()), sizeof(float) * pixels);
+        in.read(reinterpret_cast<char*>(artifacts.basis.data.get()), sizeof(float) * pixels * pixels);
+
+        return bool(in);
+    }
+
+    /*
+    @brief remove the least recently used entries until the cache fits into maxBytes, the entry that was just written
+    is always kept
+    */
+    void evict(const string& keep){
+        struct Entry {
+            string file;
+            uint64_t bytes;
+            uint64_t used; //modification time in nanoseconds
+        };
+
+        vector<Entry> entries;
+        uint64_t total = 0;
+
+        DIR* dir = opendir(directory.c_str());
+        if(!dir){
+            return;
+        }
+        while(dirent* item = readdir(dir)){
+            string name = item->d_name;
+            if((name.size() < 4) || (name.compare(name.size() - 4, 4, ".eig") != 0)){
+                continue;
+            }
+
+            string file = directory + "/" + name;
+            struct stat info;
+            if(stat(file.c_str(), &info) != 0){
+                continue;
+            }
+
+            Entry entry = {file, uint64_t(info.st_size), uint64_t(info.st_mtim.tv_sec) * 1000000000ULL + info.st_mtim.tv_nsec};
+            entries.push_back(entry);
+            total += entry.bytes;
+        }
+        closedir(dir);
+
+        sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){ return a.used < b.used; });
+
+        for(const auto& entry : entries){
+            if(total <= maxBytes){
+                break;
+            }
+            if(entry.file == keep){
+                continue;
+            }
+            if(remove(entry.file.c_str()) == 0){
+                total -= entry.bytes;
+                evictions++;
+            }
+        }
+    }
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include "matrix.h"
+#include "image.h"
+#include "pca.h"
+#include "face.h"
+#include "cache.h"
+#include "trace.h"
+
+using namespace std;
+
+/*
+@brief eigenface model of the training faces at one resolution
+@param poolingFactor factor the faces of this level are pooled by
+@param mean the average face (pixels by 1)
+@param basis the k leading eigenvectors (pixels by k, column-major)
+@param weights projections of the training faces (number of training faces by k)
+@param kernels face kernels of the geometry of this level
+*/
+struct CascadeLevel {
+    int poolingFactor;
+    Matrix<float> mean = Matrix<float>(1, 1);
+    Matrix<float, ColMajor> basis = Matrix<float, ColMajor>(1, 1);
+    Matrix<float> weights = Matrix<float>(1, 1);
+    FaceKernelTable kernels;
+};
+
+/*
+@brief models of the same training faces at several resolutions, ordered from the coarsest to the finest. A probe is
+compared against every training face with the coarsest level only, the following levels rerank the shortlist
+@param levels one model per pooling factor
+@param labels names of the training faces
+*/
+struct Cascade {
+    vector<CascadeLevel> levels;
+    vector<string> labels;
+};
+
+/*
+@brief the faces pooled by every factor, pooling an already decoded image is much cheaper than decoding it again
+@param images the decoded images (usually pooled by 1)
+@param poolingFactors factors relative to the decoded images
+@returns one vector<Image> per factor
+*/
+vector<vector<Image>> poolImages(const vector<Image>& images, const vector<int>& poolingFactors){
+    TRACE_SCOPE("pool");
+
+    vector<vector<Image>> pooled(poolingFactors.size());
+    for(int l = 0; l<poolingFactors.size(); l++){
+        for(const auto& image : images){
+            pooled[l].push_back(image.pooled(poolingFactors[l]));
+        }
+    }
+
+    return pooled;
+}
+
+/*
+@brief train one eigenface model per pooling factor from the same decoded training faces
+@param trainData the decoded training images (usually pooled by 1)
+@param poolingFactors factors of the levels relative to trainData, sorted from the coarsest level to the finest
+@param k amount of eigenvectors per level (at most the pixels of the coarsest level)
+@param iterations amount of QR iterations for the eigendecompositions (50000 by default)
+@param cache cache of earlier decompositions, a level that was already decomposed is read from it (disabled by default)
+@returns Cascade with the levels in the order of poolingFactors
+*/
+Cascade trainCascade(const vector<Image>& trainData, vector<int> poolingFactors, int k, int iterations = 50000,
+                     TrainingCache* cache = nullptr){
+    TRACE_SCOPE("train cascade");
+
+    if(trainData.empty() || poolingFactors.empty()){
+        throw domain_error("a cascade needs training images and at least one pooling factor");
+    }
+    sort(poolingFactors.begin(), poolingFactors.end(), greater<int>());
+
+    Cascade cascade;
+    for(const auto& image : trainData){
+        cascade.labels.push_back(image.getName());
+    }
+
+    auto pooled = poolImages(trainData, poolingFactors);
+    for(int l = 0; l<poolingFactors.size(); l++){
+        const vector<Image>& faces = pooled[l];
+        int rows = faces[0].data->M;
+        int cols = faces[0].data->N;
+        if(k > rows * cols){
+            throw domain_error("k larger than the amount of pixels of a level");
+        }
+
+        CascadeLevel level;
+        level.poolingFactor = poolingFactors[l];
+        level.kernels = faceKernels(rows, cols);
+
+        Matrix<float> averageFaceVector = meanFace(faces);
+        Matrix<float, ColMajor> A = faceMatrix(faces, averageFaceVector);
+
+        TrainingArtifacts artifacts;
+        if(cache){
+            artifacts.key = trainingKey(faces, iterations);
+        }
+        if(!cache || !cache->lookup(artifacts.key, artifacts)){
+            Matrix<float, ColMajor> C = Matrix<float, ColMajor>::multTransposed(A);
+            auto decomposition = C.eigen(iterations);
+            artifacts.mean = averageFaceVector;
+            artifacts.basis = get<0>(decomposition);
+            artifacts.values = get<1>(decomposition);
+            if(cache){
+                cache->store(artifacts);
+            }
+        }
+
+        level.mean = averageFaceVector;
+        level.basis = artifacts.basis.slice(0, k);
+        level.weights = Matrix<float>::multMat(A.transposedView(), level.basis);
+        cascade.levels.push_back(level);
+    }
+
+    return cascade;
+}
+
+/*
+@brief recognise a probe by matching it against all training faces at the coarsest level, keeping the shortlist closest
+ones and reranking them at the finer levels. Every intermediate level halves the shortlist, the finest level picks the
+closest face
+@param cascade the trained cascade
+@param probe the decoded probe (pooled like the training images of the cascade)
+@param shortlist amount of candidates kept after the coarsest level (all training faces if <= 0)
+@returns index of the closest training face
+*/
+int recognize(const Cascade& cascade, const Image& probe, int shortlist){
+    int count = cascade.labels.size();
+    shortlist = (shortlist <= 0) ? count : min(shortlist, count);
+
+    vector<int> candidates(count);
+    for(int i = 0; i<count; i++){
+        candidates[i] = i;
+    }
+
+    vector<pair<float, int>> distances;
+    for(int l = 0; l<cascade.levels.size(); l++){
+        const CascadeLevel& level = cascade.levels[l];
+        Image face = probe.pooled(level.poolingFactor);
+        if((face.data->M != level.kernels.rows) || (face.data->N != level.kernels.cols)){
+            throw domain_error("Matrix dimensions do not match");
+        }
+
+        int k = level.basis.N;
+        vector<float> centered(level.kernels.pixels);
+        vector<float> w(k);
+        level.kernels.center(face.data->data.get(), level.mean.data.get(), centered.data(), level.kernels.pixels);
+        level.kernels.project(centered.data(), level.basis.data.get(), k, w.data(), level.kernels.pixels);
+
+        distances.clear();
+        for(int j : candidates){
+            float distance = 0.0;
+            for(int c = 0; c<k; c++){
+                float diff = w[c] - level.weights(j, c);
+                distance += diff * diff;
+            }
+            distances.push_back(make_pair(distance, j));
+        }
+
+        //the finest level only needs the closest face
+        bool last = (l + 1 == cascade.levels.size());
+        int keep = last ? 1 : max(1, min(shortlist >> l, int(distances.size())));
+        partial_sort(distances.begin(), distances.begin() + keep, distances.end());
+
+        candidates.clear();
+        for(int i = 0; i<keep; i++){
+            candidates.push_back(distances[i].second);
+        }
+    }
+
+    return candidates[0];
+}
+
+/*
+@brief accuracy and latency of recognising the test set with one configuration
+@param name the levels of the configuration, e.g. "8>2" for a cascade or "2" for a single resolution
+@param shortlist amount of candidates kept after the coarsest level (0 for single-resolution matching)
+@param accuracy fraction of correctly recognised test faces
+@param probeMicros average time to pool, project and match a single probe
+*/
+struct CascadeResult {
+    string name;
+    int shortlist;
+    float accuracy;
+    double probeMicros;
+};
+
+/*
+@brief compare cascades with different shortlist sizes against single-resolution matching at every level. The images
+are decoded once and every resolution is pooled from the decoded faces
+@param split amount of the images to be used as training data
+@param poolingFactors pooling factors of the levels
+@param k amount of eigenvectors per level
+@param shortlists candidate shortlist sizes
+@param iterations amount of QR iterations for the eigendecompositions (50000 by default)
+@param cache cache of earlier decompositions (disabled by default)
+@returns vector<CascadeResult> with one entry per single level and one per shortlist size
+*/
+vector<CascadeResult> evaluateCascade(float split, const vector<int>& poolingFactors, int k, const vector<int>& shortlists,
+                                      int iterations = 50000, TrainingCache* cache = nullptr){
+    auto data = splitData(loadImages(1), split);
+    auto trainData = get<0>(data);
+    auto testData = get<1>(data);
+
+    auto measure = [&](const Cascade& cascade, const string& name, int shortlist){
+        int correct = 0;
+        auto start = chrono::steady_clock::now();
+        for(const auto& probe : testData){
+            if(cascade.labels[recognize(cascade, probe, shortlist)] == probe.getName()){
+                correct++;
+            }
+        }
+        double elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+        CascadeResult result;
+        result.name = name;
+        result.shortlist = shortlist;
+        result.accuracy = testData.empty() ? 0.0 : float(correct) / testData.size();
+        result.probeMicros = elapsed / max(int(testData.size()), 1);
+        return result;
+    };
+
+    Cascade cascade = trainCascade(trainData, poolingFactors, k, iterations, cache);
+    vector<CascadeResult> results;
+
+    //every level on its own, with the models of the cascade
+    string name;
+    for(const auto& level : cascade.levels){
+        Cascade single;
+        single.labels = cascade.labels;
+        single.levels.push_back(level);
+        results.push_back(measure(single, to_string(level.poolingFactor), 0));
+        name += (name.empty() ? "" : ">") + to_string(level.poolingFactor);
+    }
+
+    for(int shortlist : shortlists){
+        results.push_back(measure(cascade, name, shortlist));
+    }
+
+    return results;
+}
+
+/*
+@brief print the results of evaluateCascade as a table
+@param results the results returned by evaluateCascade
+*/
+void printCascade(const vector<CascadeResult>& results){
+    cout << "===== Cascade Results =====" << endl;
+    cout << setw(10) << "levels" << setw(12) << "shortlist" << setw(12) << "accuracy" << setw(14) << "probe [us]" << endl;
+
+    for(const auto& result : results){
+        cout << setw(10) << result.name << setw(12) << (result.shortlist > 0 ? to_string(result.shortlist) : "-")
+             << fixed << setprecision(2) << setw(12) << result.accuracy << setw(14) << result.probeMicros << endl;
+    }
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "matrix.h"
+#include "progress.h"
+
+using namespace std;
+
+/*
+@brief state of the eigen iterations that is needed to continue them
+@param key hash of the decomposed matrix so a checkpoint is only used for the matrix it belongs to
+@param iteration amount of finished iterations
+@param residual norm of the off-diagonal elements at that iteration
+@param values current iterate whose diagonal converges to the eigenvalues (M by M, column-major)
+@param vectors current approximation of the eigenvectors (M by M, column-major)
+*/
+struct EigenCheckpoint {
+    uint64_t key = 0;
+    int iteration = 0;
+    float residual = 0.0;
+    Matrix<float, ColMajor> values = Matrix<float, ColMajor>(1, 1);
+    Matrix<float, ColMajor> vectors = Matrix<float, ColMajor>(1, 1);
+};
+
+/*
+@brief FNV-1a hash of the dimensions and elements of a matrix
+@param a the matrix to hash
+@returns 64 bit hash
+*/
+template<StorageOrder Order>
+uint64_t hashMatrix(const Matrix<float, Order>& a){
+    uint64_t hash = 14695981039346656037ULL;
+
+    auto add = [&hash](const unsigned char* bytes, size_t size){
+        for(size_t i = 0; i<size; i++){
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    add(reinterpret_cast<const unsigned char*>(&a.M), sizeof(a.M));
+    add(reinterpret_cast<const unsigned char*>(&a.N), sizeof(a.N));
+    add(reinterpret_cast<const unsigned char*>(a.data.get()), sizeof(float) * a.M * a.N);
+
+    return hash;
+}
+
+/*
+@brief write a checkpoint as binary file. The file is written next to the target and renamed afterwards, so a crash while
+writing never leaves a broken checkpoint behind
+@param path path of the checkpoint
+@param checkpoint the state to write
+*/
+void writeCheckpoint(const string& path, const EigenCheckpoint& checkpoint){
+    string temporary = path + ".tmp";
+    {
+        ofstream out(temporary, ios::binary | ios::trunc);
+        if(!out){
+            throw runtime_error("could not write checkpoint " + temporary);
+        }
+
+        int M = checkpoint.values.M;
+        out.write("EIG2", 4);
+        out.write(reinterpret_cast<const char*>(&checkpoint.key), sizeof(checkpoint.key));
+        out.write(reinterpret_cast<const char*>(&checkpoint.iteration), sizeof(checkpoint.iteration));
+        out.write(reinterpret_cast<const char*>(&checkpoint.residual), sizeof(checkpoint.residual));
+        out.write(reinterpret_cast<const char*>(&M), sizeof(M));
+        out.write(reinterpret_cast<const char*>(checkpoint.values.data.get()), sizeof(float) * M * M);
+        out.write(reinterpret_cast<const char*>(checkpoint.vectors.data.get()), sizeof(float) * M * M);
+    }
+
+    if(rename(temporary.c_str(), path.c_str()) != 0){
+        throw runtime_error("could not move checkpoint to " + path);
+    }
+}
+
+/*
+@brief read a checkpoint written by writeCheckpoint
+@param path path of the checkpoint
+@param checkpoint the state that is read
+@param expected dimension the checkpoint has to have, anything else is rejected before it is allocated (any by default)
+@returns true if a complete checkpoint was read
+*/
+bool readCheckpoint(const string& path, EigenCheckpoint& checkpoint, int expected = 0){
+    ifstream in(path, ios::binary | ios::ate);
+    if(!in){
+        return false;
+    }
+    uint64_t fileBytes = in.tellg();
+    in.seekg(0);
+
+    char magic[4];
+    int M = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&checkpoint.key), sizeof(checkpoint.key));
+    in.read(reinterpret_cast<char*>(&checkpoint.iteration), sizeof(checkpoint.iteration));
+    in.read(reinterpret_cast<char*>(&checkpoint.residual), sizeof(checkpoint.residual));
+    in.read(reinterpret_cast<char*>(&M), sizeof(M));
+
+    if(!in || (memcmp(magic, "EIG2", 4) != 0) || (M <= 0) || ((expected > 0) && (M != expected))){
+        return false;
+    }
+
+    //a truncated or corrupt header must not size the allocation
+    uint64_t header = 4 + sizeof(checkpoint.key) + sizeof(checkpoint.iteration) + sizeof(checkpoint.residual) + sizeof(M);
+    if(fileBytes != header + 2 * sizeof(float) * uint64_t(M) * uint64_t(M)){
+        return false;
+    }
+
+    checkpoint.values = Matrix<float, ColMajor>(M, M);
+    checkpoint.vectors = Matrix<float, ColMajor>(M, M);
+    in.read(reinterpret_cast<char*>(checkpoint.values.data.get()), sizeof(float) * M * M);
+    in.read(reinterpret_cast<char*>(checkpoint.vectors.data.get()), sizeof(float) * M * M);
+
+    return bool(in);
+}
+
+/*
+@brief writes checkpoints of the eigen iterations on a background thread. Snapshots are copied into one of two buffers
+while the other one may be written, so the iterations only wait for the copy. If a snapshot is taken while the previous
+one has not been picked up yet, the newer one replaces it
+@param path path of the checkpoint file
+@param key hash of the decomposed matrix
+*/
+struct Checkpointer {
+    string path;
+    uint64_t key;
+    EigenCheckpoint buffers[2];
+    int pending = -1;
+    int writing = -1;
+    int written = 0;
+    bool stop = false;
+    mutex m;
+    condition_variable cv;
+    thread writer;
+
+    Checkpointer(const string& path, uint64_t key) : path(path), key(key) {
+        writer = thread([this](){
+            unique_lock<mutex> lock(m);
+            while(true){
+                cv.wait(lock, [this](){ return (pending >= 0) || stop; });
+                if(pending < 0){
+                    break;
+                }
+
+                writing = pending;
+                pending = -1;
+                lock.unlock();
+
+                try{
+                    writeCheckpoint(this->path, buffers[writing]);
+                }
+                catch(const exception& error){
+                    cerr << error.what() << endl;
+                }
+
+                lock.lock();
+                writing = -1;
+                written++;
+            }
+        });
+    }
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    /*
+    @brief writes the last snapshot if it is still pending and stops the background thread
+    */
+    ~Checkpointer(){
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_one();
+        writer.join();
+    }
+
+    /*
+    @brief copy the current state into the buffer that is not being written and hand it to the background thread
+    */
+    void snapshot(const Matrix<float, ColMajor>& values, const Matrix<float, ColMajor>& vectors, int iteration, float residual){
+        int slot;
+        {
+            lock_guard<mutex> lock(m);
+            slot = (writing == 0) ? 1 : 0;
+            if(pending == slot){
+                pending = -1;
+            }
+        }
+
+        EigenCheckpoint& checkpoint = buffers[slot];
+        if(checkpoint.values.M != values.M){
+            checkpoint.values = Matrix<float, ColMajor>(values.M, values.N);
+            checkpoint.vectors = Matrix<float, ColMajor>(vectors.M, vectors.N);
+        }
+        memcpy(checkpoint.values.data.get(), values.data.get(), sizeof(float) * values.M * values.N);
+        memcpy(checkpoint.vectors.data.get(), vectors.data.get(), sizeof(float) * vectors.M * vectors.N);
+        checkpoint.key = key;
+        checkpoint.iteration = iteration;
+        checkpoint.residual = residual;
+
+        {
+            lock_guard<mutex> lock(m);
+            pending = slot;
+        }
+        cv.notify_one();
+    }
+
+    /*
+    @brief callback for eigen that takes a snapshot on every report
+    */
+    EigenCallback callback(){
+        return [this](const EigenProgress& progress){
+            snapshot(*progress.values, *progress.vectors, progress.iteration, progress.offDiagonal);
+            return true;
+        };
+    }
+};
+
+/*
+@brief eigen with periodic checkpoints that continues from the checkpoint at path if it belongs to the same matrix
+@param a the matrix to decompose
+@param iterations total amount of iterations to be done
+@param path path of the checkpoint file
+@param interval amount of iterations between two checkpoints (at least 1)
+@param callback additional progress callback (optional)
+@param verbose print where the iterations are resumed from (false by default)
+@returns returns Matrix E (M by M) containing all the eigenvectors and Matrix e (M by 1) with all the eigenvalues
+*/
+template<StorageOrder Order>
+tuple<Matrix<float, Order>, Matrix<float, Order>> checkpointedEigen(Matrix<float, Order>& a, int iterations, const string& path, int interval,
+                                                                    const EigenCallback& callback = EigenCallback(),
+                                                                    bool verbose = false){
+    if(interval < 1){
+        throw domain_error("checkpoint interval has to be a positive integer");
+    }
+
+    //the external backend solves the symmetric problem directly, there are no iterations to checkpoint
+    if(Backend::active()){
+        return a.eigen(iterations, callback, interval);
+    }
+
+    uint64_t key = hashMatrix(a);
+
+    Matrix<float, ColMajor> temp = a.template reorder<ColMajor>();
+    Matrix<float, ColMajor> E = temp.identity();
+    int first = 0;
+
+    EigenCheckpoint checkpoint;
+    if(readCheckpoint(path, checkpoint, a.M) && (checkpoint.key == key)){
+        if(verbose){
+            cout << "Resuming eigen from iteration " << checkpoint.iteration << " (off-diagonal norm " << checkpoint.residual << ")" << endl;
+        }
+        temp = checkpoint.values;
+        E = checkpoint.vectors;
+        first = checkpoint.iteration;
+    }
+
+    Checkpointer checkpointer(path, key);
+    auto result = Matrix<float>::resumeEigen(temp, E, first, iterations, combineCallbacks(callback, checkpointer.callback()), interval);
+    return make_tuple(get<0>(result).template reorder<Order>(), get<1>(result).template reorder<Order>());
+}
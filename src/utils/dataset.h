@@ -0,0 +1,325 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include "matrix.h"
+#include "image.h"
+#include "pca.h"
+#include "trace.h"
+
+using namespace std;
+
+/*
+@brief what is known about an image before it is decoded
+@param path path to the location of the jpg image
+@param name name of the subject
+@param imageNumber number of the image within its subject (-1 if unknown)
+*/
+struct FaceRecord {
+    string path;
+    string name;
+    int imageNumber;
+};
+
+/*
+@brief dataset that only records the paths and labels of the images and decodes a face on its first access. Decoded
+faces are kept in a least recently used cache that is bounded by the bytes of the pooled pixels, so the memory follows
+the faces that are in use instead of the size of the dataset. An evicted face stays valid for as long as a caller holds
+it. Sequential access (i after i - 1) makes a background thread decode the next prefetchDepth faces ahead of time, and
+prefetch() can be used as a hint for any other order. A face is decoded by one thread at a time, a get() of a face that is
+being decoded waits for it instead of decoding it again. All methods can be called from several threads
+@param poolingFactor to compress the images (default is 2)
+@param maxBytes upper bound of the pixels kept in the cache (64 MB by default), the face that was just decoded is always kept
+@param prefetchDepth amount of faces decoded ahead of a sequential scan (4 by default, 0 disables the background thread)
+@param paths paths of the images (all images of the dataset by default)
+*/
+struct LazyDataset {
+    struct Entry {
+        Image image;
+        list<int>::iterator position;
+        size_t bytes;
+    };
+
+    vector<FaceRecord> records;
+    int poolingFactor;
+    size_t maxBytes;
+    int prefetchDepth;
+
+    mutex m;
+    condition_variable wake;
+    condition_variable ready; //a decode has finished
+    list<int> order; //most recently used first
+    unordered_map<int, Entry> entries;
+    deque<int> queue; //faces the background thread should decode
+    unordered_set<int> queued;
+    unordered_set<int> decoding; //faces that a thread is decoding right now
+    thread prefetcher;
+    bool stop = false;
+    int last = -1;
+
+    size_t bytes = 0;
+    size_t peakBytes = 0;
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+    int prefetched = 0;
+    int evictedWaits = 0; //waits for a decode whose face was evicted before it was used
+
+    LazyDataset(int poolingFactor = 2, size_t maxBytes = 64 << 20, int prefetchDepth = 4,
+                const vector<string>& paths = imagePaths())
+        : poolingFactor(poolingFactor), maxBytes(maxBytes), prefetchDepth(prefetchDepth) {
+        for(const auto& path : paths){
+            FaceRecord record;
+            record.path = path;
+            Image::parseName(path, record.name, record.imageNumber);
+            records.push_back(record);
+        }
+
+        if(prefetchDepth > 0){
+            prefetcher = thread([this](){ prefetchLoop(); });
+        }
+    }
+
+    LazyDataset(const LazyDataset&) = delete;
+    LazyDataset& operator=(const LazyDataset&) = delete;
+
+    ~LazyDataset(){
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_all();
+        if(prefetcher.joinable()){
+            prefetcher.join();
+        }
+    }
+
+    int size() const {
+        return records.size();
+    }
+
+    /*
+    @brief the face at an index, decoded on the first access
+    @param index position of the image in the dataset
+    @returns Image with the pooled grayscale values
+    */
+    Image get(int index){
+        if((index < 0) || (index >= records.size())){
+            throw out_of_range("image index out of range");
+        }
+
+        unique_lock<mutex> lock(m);
+
+        //a face that is being decoded is waited for, it is only decoded again if it was evicted or failed in the meantime
+        bool waited = false;
+        while(decoding.count(index)){
+            ready.wait(lock);
+            waited = true;
+        }
+
+        auto found = entries.find(index);
+        if(found != entries.end()){
+            hits++;
+            order.splice(order.begin(), order, found->second.position);
+            Image image = found->second.image;
+            scanned(index);
+            return image;
+        }
+        misses++;
+        if(waited){
+            evictedWaits++;
+        }
+
+        //decoded without the lock
+        decoding.insert(index);
+        lock.unlock();
+        Image image("", -1, nullptr);
+        try{
+            image = decode(index);
+        }
+        catch(...){
+            lock.lock();
+            decoding.erase(index);
+            ready.notify_all();
+            throw;
+        }
+        lock.lock();
+
+        decoding.erase(index);
+        ready.notify_all();
+        Image result = insert(index, image);
+        scanned(index);
+        return result;
+    }
+
+    /*
+    @brief hint that the faces will be needed soon, they are decoded by the background thread
+    @param indices positions of the images in the dataset
+    */
+    void prefetch(const vector<int>& indices){
+        if(prefetchDepth <= 0){
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+            for(int index : indices){
+                enqueue(index);
+            }
+        }
+        wake.notify_one();
+    }
+
+    /*
+    @brief decode the faces at the indices, in order. The background thread stays at most prefetchDepth faces ahead, so it
+    does not evict faces that were not returned yet
+    @param indices positions of the images in the dataset
+    @returns vector<Image> with one face per index
+    */
+    vector<Image> load(const vector<int>& indices){
+        TRACE_SCOPE("load");
+        int window = max(prefetchDepth, 0);
+        prefetch(vector<int>(indices.begin(), indices.begin() + min<size_t>(window, indices.size())));
+
+        vector<Image> images;
+        for(int i = 0; i<indices.size(); i++){
+            if(i + window < indices.size()){
+                prefetch({indices[i + window]});
+            }
+            images.push_back(get(indices[i]));
+        }
+
+        return images;
+    }
+
+    /*
+    @brief split the dataset into training and testing indices without decoding any image, the same split as splitData
+    @param split amount of the images to be used as training data (default is 0.5)
+    @param fold rotates which image numbers of each subject are used for training (default is 0)
+    @returns tuple of the training and the testing indices
+    */
+    tuple<vector<int>, vector<int>> split(float split = 0.5, int fold = 0) const {
+        vector<int> train;
+        vector<int> test;
+
+        for(int i = 0; i<records.size(); i++){
+            if(isTrainingImage(records[i].imageNumber, split, fold)){
+                train.push_back(i);
+            }
+            else{
+                test.push_back(i);
+            }
+        }
+
+        return make_tuple(train, test);
+    }
+
+    /*
+    @brief print the hits, misses, evictions and the bytes of the cache
+    */
+    void report(ostream& out = cout){
+        lock_guard<mutex> lock(m);
+        out << "===== Dataset: " << entries.size() << " of " << records.size() << " faces resident, " << bytes
+            << " bytes (peak " << peakBytes << "), " << hits << " hits, " << misses << " misses, " << evictions
+            << " evictions, " << prefetched << " prefetched, " << evictedWaits << " evicted before use =====" << endl;
+    }
+
+    Image decode(int index) const {
+        TRACE_SCOPE("decode");
+        return Image(records[index].path.c_str(), poolingFactor);
+    }
+
+    //the caller holds the lock for all of the following
+
+    Image insert(int index, const Image& image){
+        auto found = entries.find(index);
+        if(found != entries.end()){
+            order.splice(order.begin(), order, found->second.position);
+            return found->second.image;
+        }
+
+        order.push_front(index);
+        Entry entry = {image, order.begin(), sizeof(float) * image.data->M * image.data->N};
+        entries.insert(make_pair(index, entry));
+        bytes += entry.bytes;
+        peakBytes = max(peakBytes, bytes);
+
+        while((bytes > maxBytes) && (order.size() > 1)){
+            auto evicted = entries.find(order.back());
+            bytes -= evicted->second.bytes;
+            entries.erase(evicted);
+            order.pop_back();
+            evictions++;
+        }
+
+        return image;
+    }
+
+    void enqueue(int index){
+        if((index >= 0) && (index < records.size()) && !entries.count(index) && queued.insert(index).second){
+            queue.push_back(index);
+        }
+    }
+
+    void scanned(int index){
+        //explicit hints that are still pending take precedence over guessing the next faces
+        bool sequential = (index == last + 1);
+        last = index;
+        if(!sequential || (prefetchDepth <= 0) || !queue.empty()){
+            return;
+        }
+
+        for(int next = index + 1; next <= index + prefetchDepth; next++){
+            enqueue(next);
+        }
+        wake.notify_one();
+    }
+
+    void prefetchLoop(){
+        unique_lock<mutex> lock(m);
+        while(true){
+            wake.wait(lock, [this](){ return stop || !queue.empty(); });
+            if(stop){
+                return;
+            }
+
+            int index = queue.front();
+            queue.pop_front();
+            if(entries.count(index) || decoding.count(index)){
+                queued.erase(index);
+                continue;
+            }
+
+            decoding.insert(index);
+            lock.unlock();
+            bool decoded = true;
+            Image image("", -1, nullptr);
+            try{
+                image = decode(index);
+            }
+            catch(const exception&){
+                //a hint that fails is left to get(), which reports the error to its caller
+                decoded = false;
+            }
+            lock.lock();
+
+            queued.erase(index);
+            decoding.erase(index);
+            if(decoded && !entries.count(index)){
+                insert(index, image);
+                prefetched++;
+            }
+            ready.notify_all();
+        }
+    }
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include "matrix.h"
+#include "image.h"
+#include "pca.h"
+#include "face.h"
+#include "cache.h"
+
+using namespace std;
+
+/*
+@brief accuracy and latency of recognising the test set for one (split, k) combination
+*/
+struct SweepResult {
+    float split;
+    int k;
+    float accuracy;
+    double trainSeconds; //time to decompose and project one split, shared by every k of that split
+    double probeMicros; //average time to project and match a single probe with k eigenfaces
+};
+
+/*
+@brief match every test face against every training face for all candidate k in a single pass. The squared distance over
+the first k components is a prefix sum of the per component distances, so walking the components once gives the distance
+for every k
+@param trainW weights of the training faces (number of training faces by maxK)
+@param trainLabels names of the training faces
+@param testW weights of the test faces (number of test faces by maxK)
+@param testLabels names of the test faces
+@param ks candidate amounts of eigenvectors sorted in ascending order (largest has to be <= maxK)
+@returns vector<int> with the number of correctly recognised test faces for each k
+*/
+vector<int> countCorrectForEachK(const Matrix<float>& trainW, const vector<string>& trainLabels,
+                                 const Matrix<float>& testW, const vector<string>& testLabels, const vector<int>& ks){
+    if((trainW.N != testW.N) || (ks.back() > trainW.N)){
+        throw domain_error("candidate k larger than the amount of projected components");
+    }
+
+    vector<int> correct(ks.size(), 0);
+
+    for(int t = 0; t<testW.M; t++){
+        vector<float> best(ks.size(), numeric_limits<float>::max());
+        vector<int> bestIndex(ks.size(), -1);
+
+        for(int j = 0; j<trainW.M; j++){
+            float distance = 0.0;
+            int kIndex = 0;
+
+            for(int c = 0; c<ks.back(); c++){
+                float diff = testW(t, c) - trainW(j, c);
+                distance += diff * diff;
+
+                //prefix reached one of the candidate k values
+                while((kIndex < ks.size()) && (c + 1 == ks[kIndex])){
+                    if(distance < best[kIndex]){
+                        best[kIndex] = distance;
+                        bestIndex[kIndex] = j;
+                    }
+                    kIndex++;
+                }
+            }
+        }
+
+        for(int i = 0; i<ks.size(); i++){
+            if((bestIndex[i] >= 0) && (trainLabels[bestIndex[i]] == testLabels[t])){
+                correct[i]++;
+            }
+        }
+    }
+
+    return correct;
+}
+
+/*
+@brief evaluate every (split, k) combination while only doing one eigendecomposition per split and fold. Independent
+splits and folds are trained and scored in parallel, the probe latency is measured afterwards one task at a time so it
+does not include the contention of the other tasks
+@param splits amounts of the images to be used as training data
+@param ks candidate amounts of eigenvectors
+@param folds number of rotations of the training images per split (default is 1)
+@param poolingFactor to compress the image (default is 2)
+@param iterations amount of QR iterations for the eigendecomposition (50000 by default)
+@param cache cache of earlier decompositions, splits and folds that were already decomposed are read from it (disabled by default)
+@returns vector<SweepResult> with one entry per (split, k), accuracy is averaged over all folds
+*/
+vector<SweepResult> sweep(const vector<float>& splits, vector<int> ks, int folds = 1, int poolingFactor = 2, int iterations = 50000,
+                          TrainingCache* cache = nullptr){
+    sort(ks.begin(), ks.end());
+    int maxK = ks.back();
+
+    //decode the images only once for all splits
+    vector<Image> images = loadImages(poolingFactor);
+
+    int tasks = splits.size() * folds;
+    vector<vector<int>> correct(tasks);
+    vector<int> tested(tasks, 0);
+    vector<double> trainSeconds(tasks, 0.0);
+    vector<vector<double>> probeMicros(tasks, vector<double>(ks.size(), 0.0));
+
+    //kept for the latency measurement after the parallel region
+    vector<Matrix<float, ColMajor>> bases(tasks, Matrix<float, ColMajor>(1, 1));
+    vector<Matrix<float, ColMajor>> probes(tasks, Matrix<float, ColMajor>(1, 1));
+    vector<Matrix<float>> trainWeights(tasks, Matrix<float>(1, 1));
+
+    #pragma omp parallel for schedule(dynamic) if(tasks > 1)
+    for(int task = 0; task<tasks; task++){
+        auto data = splitData(images, splits[task / folds], task % folds);
+        auto trainData = get<0>(data);
+        auto testData = get<1>(data);
+
+        auto start = chrono::steady_clock::now();
+
+        //one decomposition for the largest k, smaller k use the leading columns of the same basis
+        Matrix<float> averageFaceVector = meanFace(trainData);
+        Matrix<float, ColMajor> A = faceMatrix(trainData, averageFaceVector);
+
+        //a cached decomposition of the same training set is reused
+        TrainingArtifacts artifacts;
+        if(cache){
+            artifacts.key = trainingKey(trainData, iterations);
+        }
+        if(!cache || !cache->lookup(artifacts.key, artifacts)){
+            Matrix<float, ColMajor> C = Matrix<float, ColMajor>::multTransposed(A);
+            auto decomposition = C.eigen(iterations);
+            artifacts.mean = averageFaceVector;
+            artifacts.basis = get<0>(decomposition);
+            artifacts.values = get<1>(decomposition);
+            if(cache){
+                cache->store(artifacts);
+            }
+        }
+        auto basis = artifacts.basis.slice(0, maxK);
+
+        Matrix<float> trainW = Matrix<float>::multMat(A.transposedView(), basis);
+        Matrix<float, ColMajor> B = faceMatrix(testData, averageFaceVector);
+        Matrix<float> testW = Matrix<float>::multMat(B.transposedView(), basis);
+
+        trainSeconds[task] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        vector<string> trainLabels;
+        vector<string> testLabels;
+        for(const auto& image : trainData){
+            trainLabels.push_back(image.getName());
+        }
+        for(const auto& image : testData){
+            testLabels.push_back(image.getName());
+        }
+
+        correct[task] = countCorrectForEachK(trainW, trainLabels, testW, testLabels, ks);
+        tested[task] = testData.size();
+
+        bases[task] = basis;
+        probes[task] = B;
+        trainWeights[task] = trainW;
+    }
+
+    //latency of recognising one probe with a model of k eigenfaces, the projection uses the kernels of the image geometry
+    auto kernels = faceKernels(images[0].data->M, images[0].data->N);
+    for(int task = 0; task<tasks; task++){
+        const Matrix<float, ColMajor>& basis = bases[task];
+        const Matrix<float, ColMajor>& B = probes[task];
+        const Matrix<float>& trainW = trainWeights[task];
+
+        for(int i = 0; i<ks.size(); i++){
+            int k = ks[i];
+            float matched = 0.0;
+            auto probeStart = chrono::steady_clock::now();
+
+            for(int t = 0; t<B.N; t++){
+                vector<float> w(k, 0.0);
+                kernels.project(B.data.get() + t * B.M, basis.data.get(), k, w.data(), kernels.pixels);
+
+                float best = numeric_limits<float>::max();
+                for(int j = 0; j<trainW.M; j++){
+                    float distance = 0.0;
+                    for(int c = 0; c<k; c++){
+                        float diff = w[c] - trainW(j, c);
+                        distance += diff * diff;
+                    }
+                    best = min(best, distance);
+                }
+                matched += best;
+            }
+
+            double elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - probeStart).count();
+            probeMicros[task][i] = elapsed / max(B.N, 1);
+
+            //keep the timed loop from being optimised away
+            volatile float sink = matched;
+            (void)sink;
+        }
+    }
+
+    //combine the folds of every split
+    vector<SweepResult> results;
+    for(int s = 0; s<splits.size(); s++){
+        for(int i = 0; i<ks.size(); i++){
+            int correctTotal = 0;
+            int testedTotal = 0;
+            double seconds = 0.0;
+            double micros = 0.0;
+
+            for(int f = 0; f<folds; f++){
+                int task = s * folds + f;
+                correctTotal += correct[task][i];
+                testedTotal += tested[task];
+                seconds += trainSeconds[task];
+                micros += probeMicros[task][i];
+            }
+
+            SweepResult result;
+            result.split = splits[s];
+            result.k = ks[i];
+            result.accuracy = (testedTotal > 0) ? float(correctTotal) / testedTotal : 0.0;
+            result.trainSeconds = seconds / folds;
+            result.probeMicros = micros / folds;
+            results.push_back(result);
+        }
+    }
+
+    return results;
+}
+
+/*
+@brief print the results of a sweep as a table
+@param results the results returned by sweep
+*/
+void printSweep(const vector<SweepResult>& results){
+    cout << "===== Sweep Results =====" << endl;
+    cout << setw(8) << "split" << setw(8) << "k" << setw(12) << "accuracy" << setw(14) << "train [s]" << setw(14) << "probe [us]" << endl;
+
+    for(const auto& result : results){
+        cout << fixed << setprecision(2) << setw(8) << result.split << setw(8) << result.k
+             << setw(12) << result.accuracy << setw(14) << result.trainSeconds << setw(14) << result.probeMicros << endl;
+    }
+}
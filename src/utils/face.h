@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/*
+@brief kernels over the pixels of one flattened face. With Pixels > 0 the extent is a compile-time constant, so every
+loop has a known trip count that the compiler can unroll and vectorize without remainder checks. Pixels = 0 is the
+dynamic version that uses the pixels argument instead
+@tparam Pixels amount of pixels of a face (rows * cols) or 0 for a runtime extent
+*/
+template<int Pixels>
+struct FaceKernels {
+
+  static inline int extent(int pixels){
+    return (Pixels > 0) ? Pixels : pixels;
+  }
+
+  /*
+  @brief add a face to a running sum (for the mean face)
+  */
+  static void accumulate(const float* face, float* sum, int pixels){
+    const int n = extent(pixels);
+    for(int i = 0; i<n; i++){
+      sum[i] += face[i];
+    }
+  }
+
+  /*
+  @brief subtract the mean face from a face
+  @param face the face
+  @param mean the mean face
+  @param out the centered face (can be the same as face)
+  */
+  static void center(const float* face, const float* mean, float* out, int pixels){
+    const int n = extent(pixels);
+    for(int i = 0; i<n; i++){
+      out[i] = face[i] - mean[i];
+    }
+  }
+
+  /*
+  @brief dot product of two faces, accumulated in 8 independent partial sums so the loop vectorizes without
+  reassociating the floating point additions
+  */
+  static float dot(const float* a, const float* b, int pixels){
+    const int n = extent(pixels);
+    float partial[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+      for(int l = 0; l<8; l++){
+        partial[l] += a[i + l] * b[i + l];
+      }
+    }
+
+    float sum = 0.0;
+    for(; i<n; i++){
+      sum += a[i] * b[i];
+    }
+    for(int l = 0; l<8; l++){
+      sum += partial[l];
+    }
+    return sum;
+  }
+
+  /*
+  @brief project a centered face onto the first k eigenfaces
+  @param centered the centered face
+  @param basis column-major eigenfaces (pixels by at least k), one contiguous column per eigenface
+  @param k amount of eigenfaces
+  @param weights the k weights of the face
+  */
+  static void project(const float* centered, const float* basis, int k, float* weights, int pixels){
+    const int n = extent(pixels);
+    for(int c = 0; c<k; c++){
+      weights[c] = dot(centered, basis + c * n, n);
+    }
+  }
+
+  static const int ProbeBatch = 4;
+  static const int PixelBlock = 256;
+
+  /*
+  @brief project 8-bit faces onto the first k eigenfaces without a float copy of the faces. The pixels are widened and
+  centered one block at a time into a buffer that stays in L1, and every block of an eigenface that is read is used by
+  up to ProbeBatch faces, so the basis is streamed once per ProbeBatch faces instead of once per face
+  @param faces the pixels of every face (row-major, pixels each)
+  @param count amount of faces
+  @param mean the mean face
+  @param basis column-major eigenfaces (pixels by at least k), one contiguous column per eigenface
+  @param k amount of eigenfaces
+  @param weights the weights of the faces (count by k, row-major)
+  */
+  static void projectBytes(const uint8_t* const* faces, int count, const float* mean, const float* basis, int k,
+                           float* weights, int pixels){
+    const int n = extent(pixels);
+    fill(weights, weights + size_t(count) * k, 0.0f);
+
+    float centered[ProbeBatch][PixelBlock];
+    for(int first = 0; first<count; first += ProbeBatch){
+      const int batch = min(ProbeBatch, count - first);
+
+      for(int start = 0; start<n; start += PixelBlock){
+        const int length = min(PixelBlock, n - start);
+        for(int p = 0; p<batch; p++){
+          const uint8_t* face = faces[first + p] + start;
+          for(int i = 0; i<length; i++){
+            centered[p][i] = float(face[i]) - mean[start + i];
+          }
+        }
+
+        //the block of the eigenface is read from memory for the first face and from L1 for the others
+        for(int c = 0; c<k; c++){
+          const float* column = basis + size_t(c) * n + start;
+          for(int p = 0; p<batch; p++){
+            weights[size_t(first + p) * k + c] += (length == PixelBlock)
+                ? FaceKernels<PixelBlock>::dot(centered[p], column, PixelBlock)
+                : FaceKernels<0>::dot(centered[p], column, length);
+          }
+        }
+      }
+    }
+  }
+};
+
+/*
+@brief the face kernels selected for one image geometry
+@param rows rows of the images
+@param cols columns of the images
+@param pixels rows * cols, passed to every kernel
+@param fixed true if a compile-time specialization was found for the geometry
+*/
+struct FaceKernelTable {
+  int rows;
+  int cols;
+  int pixels;
+  bool fixed;
+  void (*accumulate)(const float* face, float* sum, int pixels);
+  void (*center)(const float* face, const float* mean, float* out, int pixels);
+  float (*dot)(const float* a, const float* b, int pixels);
+  void (*project)(const float* centered, const float* basis, int k, float* weights, int pixels);
+  void (*projectBytes)(const uint8_t* const* faces, int count, const float* mean, const float* basis, int k, float* weights,
+                       int pixels);
+};
+
+template<int Pixels>
+FaceKernelTable makeFaceKernelTable(int rows, int cols){
+  FaceKernelTable table;
+  table.rows = rows;
+  table.cols = cols;
+  table.pixels = rows * cols;
+  table.fixed = (Pixels > 0);
+  table.accumulate = &FaceKernels<Pixels>::accumulate;
+  table.center = &FaceKernels<Pixels>::center;
+  table.dot = &FaceKernels<Pixels>::dot;
+  table.project = &FaceKernels<Pixels>::project;
+  table.projectBytes = &FaceKernels<Pixels>::projectBytes;
+  return table;
+}
+
+/*
+@brief select the kernels for an image geometry. The ORL faces of this repository (80 by 70) and the original ORL
+release (112 by 92) have specializations for every pooling factor the program uses, other geometries use the dynamic
+kernels
+@param rows rows of the images
+@param cols columns of the images
+@returns table with the kernels to use
+*/
+FaceKernelTable faceKernels(int rows, int cols){
+  if((rows <= 0) || (cols <= 0)){
+    throw domain_error("invalid face geometry");
+  }
+
+  //80 by 70 pooled by 1, 2, 4 and 8
+  if((rows == 80) && (cols == 70)){
+    return makeFaceKernelTable<80 * 70>(rows, cols);
+  }
+  if((rows == 40) && (cols == 35)){
+    return makeFaceKernelTable<40 * 35>(rows, cols);
+  }
+  if((rows == 20) && (cols == 17)){
+    return makeFaceKernelTable<20 * 17>(rows, cols);
+  }
+  if((rows == 10) && (cols == 8)){
+    return makeFaceKernelTable<10 * 8>(rows, cols);
+  }
+
+  //112 by 92 pooled by 1 and 2
+  if((rows == 112) && (cols == 92)){
+    return makeFaceKernelTable<112 * 92>(rows, cols);
+  }
+  if((rows == 56) && (cols == 46)){
+    return makeFaceKernelTable<56 * 46>(rows, cols);
+  }
+
+  return makeFaceKernelTable<0>(rows, cols);
+}
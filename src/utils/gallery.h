@@ -0,0 +1,396 @@
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include "matrix.h"
+#include "parallel.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+/*
+@brief the CPUs of every NUMA node that this process may run on
+@param nodes one list of CPU ids per node
+*/
+struct NumaTopology {
+  vector<vector<int>> nodes;
+
+  /*
+  @brief CPUs the process is allowed to run on
+  */
+  static vector<int> allowedCpus(){
+    vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+      for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+        if(CPU_ISSET(cpu, &allowed)){
+          cpus.push_back(cpu);
+        }
+      }
+    }
+#endif
+    if(cpus.empty()){
+      cpus.push_back(-1); //unknown, threads are not pinned
+    }
+    return cpus;
+  }
+
+  /*
+  @brief parse a sysfs CPU list like "0-3,8,10-11"
+  */
+  static vector<int> parseCpuList(const string& list){
+    vector<int> cpus;
+    stringstream stream(list);
+    string range;
+    while(getline(stream, range, ',')){
+      if(range.empty() || !isdigit(range[0])){
+        continue;
+      }
+      size_t dash = range.find('-');
+      int first = stoi(range.substr(0, dash));
+      int last = (dash == string::npos) ? first : stoi(range.substr(dash + 1));
+      for(int cpu = first; cpu <= last; cpu++){
+        cpus.push_back(cpu);
+      }
+    }
+    return cpus;
+  }
+
+  /*
+  @brief read the nodes from /sys/devices/system/node, machines without NUMA information are one node
+  @returns the nodes that contain at least one allowed CPU
+  */
+  static NumaTopology detect(){
+    vector<int> allowed = allowedCpus();
+    NumaTopology topology;
+
+    for(int node = 0; ; node++){
+      ifstream in("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+      if(!in){
+        break;
+      }
+      string list;
+      getline(in, list);
+
+      vector<int> cpus;
+      for(int cpu : parseCpuList(list)){
+        if(find(allowed.begin(), allowed.end(), cpu) != allowed.end()){
+          cpus.push_back(cpu);
+        }
+      }
+      if(!cpus.empty()){
+        topology.nodes.push_back(cpus);
+      }
+    }
+
+    if(topology.nodes.empty()){
+      topology.nodes.push_back(allowed);
+    }
+    return topology;
+  }
+
+  /*
+  @brief all allowed CPUs as one node
+  */
+  static NumaTopology single(){
+    NumaTopology topology;
+    topology.nodes.push_back(allowedCpus());
+    return topology;
+  }
+
+  /*
+  @brief the allowed CPUs split into parts nodes, to try a multi-node layout on a machine with one node
+  @param parts amount of nodes (at most one per CPU)
+  */
+  static NumaTopology split(int parts){
+    vector<int> cpus = allowedCpus();
+    parts = max(1, min(parts, int(cpus.size())));
+
+    NumaTopology topology;
+    topology.nodes.resize(parts);
+    for(int i = 0; i<cpus.size(); i++){
+      topology.nodes[i * parts / cpus.size()].push_back(cpus[i]);
+    }
+    return topology;
+  }
+
+  int cpus() const {
+    int count = 0;
+    for(const auto& node : nodes){
+      count += node.size();
+    }
+    return count;
+  }
+};
+
+/*
+@brief one entry of a search result
+@param index row of the face in the gallery
+@param distance squared euclidean distance to the probe
+*/
+struct GalleryMatch {
+  int index;
+  float distance;
+
+  bool operator<(const GalleryMatch& other) const {
+    return (distance < other.distance) || ((distance == other.distance) && (index < other.index));
+  }
+};
+
+/*
+@brief gallery of projected faces split into shards. Every shard has a thread pinned to the CPUs of one NUMA node that
+copies its rows of the gallery on start, so the pages are allocated on that node (first touch), and that searches only
+its own rows. A probe is sent to all shards, each writes its top-k into its own slot and the sorted lists are merged
+afterwards, so the threads never share a lock or a heap while searching
+@param weights the gallery (one face per row, k weights per face)
+@param topology the nodes to place the shards on (NumaTopology::detect() by default)
+@param shardsPerNode amount of shards per node (0 for one per CPU of the node)
+*/
+struct ShardedGallery {
+
+  struct Shard {
+    int node;
+    vector<int> cpus;
+    int first;
+    int count;
+    vector<float> weights;
+    vector<vector<GalleryMatch>> results; //top-k per probe of the current search
+  };
+
+  int rows;
+  int dims;
+  vector<Shard> shards;
+  vector<thread> threads;
+
+  //current search, written by search() before the threads are woken up
+  const float* probes = nullptr;
+  int probeCount = 0;
+  int topK = 0;
+
+  mutex m;
+  mutex submit;
+  condition_variable wake;
+  condition_variable finished;
+  int generation = 0;
+  int pending = 0;
+  bool stop = false;
+
+  ShardedGallery(const Matrix<float>& weights, const NumaTopology& topology = NumaTopology::detect(), int shardsPerNode = 0)
+      : rows(weights.M), dims(weights.N) {
+    if(rows <= 0){
+      throw domain_error("empty gallery");
+    }
+
+    //shard sizes follow the amount of CPUs of every node
+    vector<pair<int, vector<int>>> layout;
+    for(int node = 0; node<topology.nodes.size(); node++){
+      int count = (shardsPerNode > 0) ? shardsPerNode : max(int(topology.nodes[node].size()), 1);
+      for(int s = 0; s<count; s++){
+        layout.push_back(make_pair(node, topology.nodes[node]));
+      }
+    }
+    int shardCount = max(1, min(int(layout.size()), rows));
+    layout.resize(shardCount);
+
+    shards.resize(shardCount);
+    for(int s = 0; s<shardCount; s++){
+      shards[s].node = layout[s].first;
+      shards[s].cpus = layout[s].second;
+      shards[s].first = int(size_t(rows) * s / shardCount);
+      shards[s].count = int(size_t(rows) * (s + 1) / shardCount) - shards[s].first;
+    }
+
+    //the threads copy their rows themselves and are done with it when pending reaches 0
+    const float* source = weights.data.get();
+    pending = shardCount;
+    for(int s = 0; s<shardCount; s++){
+      threads.emplace_back([this, s, source](){ loop(s, source); });
+    }
+
+    unique_lock<mutex> lock(m);
+    finished.wait(lock, [this](){ return pending == 0; });
+  }
+
+  ShardedGallery(const ShardedGallery&) = delete;
+  ShardedGallery& operator=(const ShardedGallery&) = delete;
+
+  ~ShardedGallery(){
+    {
+      lock_guard<mutex> lock(m);
+      stop = true;
+    }
+    wake.notify_all();
+    for(auto& t : threads){
+      t.join();
+    }
+  }
+
+  static void pin(const vector<int>& cpus){
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool any = false;
+    for(int cpu : cpus){
+      if(cpu >= 0){
+        CPU_SET(cpu, &set);
+        any = true;
+      }
+    }
+    if(any){
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+  }
+
+  void loop(int s, const float* source){
+    Shard& shard = shards[s];
+    ThreadPool::isWorker() = true;
+    pin(shard.cpus);
+
+    //first touch from the pinned thread
+    shard.weights.assign(source + size_t(shard.first) * dims, source + size_t(shard.first + shard.count) * dims);
+
+    int seen = 0;
+    unique_lock<mutex> lock(m);
+    if(--pending == 0){
+      finished.notify_one();
+    }
+
+    while(true){
+      wake.wait(lock, [&](){ return stop || (generation != seen); });
+      if(stop){
+        return;
+      }
+      seen = generation;
+      lock.unlock();
+
+      searchShard(shard);
+
+      lock.lock();
+      if(--pending == 0){
+        finished.notify_one();
+      }
+    }
+  }
+
+  /*
+  @brief top-k of every probe within one shard, kept in a max-heap of size k per probe and sorted at the end. The rows
+  are the outer loop so every row of the shard is read from memory once for all probes
+  */
+  void searchShard(Shard& shard){
+    shard.results.resize(probeCount);
+    int k = min(topK, shard.count);
+    for(auto& heap : shard.results){
+      heap.clear();
+    }
+
+    for(int i = 0; i<shard.count; i++){
+      const float* face = shard.weights.data() + size_t(i) * dims;
+
+      for(int p = 0; p<probeCount; p++){
+        const float* probe = probes + size_t(p) * dims;
+        float distance = 0.0;
+        for(int c = 0; c<dims; c++){
+          float diff = probe[c] - face[c];
+          distance += diff * diff;
+        }
+
+        vector<GalleryMatch>& heap = shard.results[p];
+        GalleryMatch match = {shard.first + i, distance};
+        if(heap.size() < k){
+          heap.push_back(match);
+          push_heap(heap.begin(), heap.end());
+        }
+        else if(match < heap.front()){
+          pop_heap(heap.begin(), heap.end());
+          heap.back() = match;
+          push_heap(heap.begin(), heap.end());
+        }
+      }
+    }
+
+    for(auto& heap : shard.results){
+      sort_heap(heap.begin(), heap.end());
+    }
+  }
+
+  /*
+  @brief find the k closest gallery faces of every probe
+  @param probeWeights the probes (one per row, same amount of weights as the gallery)
+  @param k amount of matches per probe
+  @returns the matches of every probe sorted by ascending distance
+  */
+  vector<vector<GalleryMatch>> search(const Matrix<float>& probeWeights, int k){
+    if(probeWeights.N != dims){
+      throw domain_error("Matrix dimensions do not match");
+    }
+
+    lock_guard<mutex> guard(submit);
+    {
+      lock_guard<mutex> lock(m);
+      probes = probeWeights.data.get();
+      probeCount = probeWeights.M;
+      topK = max(k, 1);
+      pending = shards.size();
+      generation++;
+    }
+    wake.notify_all();
+    {
+      unique_lock<mutex> lock(m);
+      finished.wait(lock, [this](){ return pending == 0; });
+    }
+
+    //k-way merge of the sorted shard lists, independent for every probe
+    vector<vector<GalleryMatch>> results(probeCount);
+    int count = min(topK, rows);
+    parallelFor(probeCount, double(count) * shards.size(), [&](int begin, int end){
+      for(int p = begin; p<end; p++){
+        typedef pair<GalleryMatch, int> Head;
+        auto later = [](const Head& a, const Head& b){ return b.first < a.first; };
+        priority_queue<Head, vector<Head>, decltype(later)> heads(later);
+        vector<int> position(shards.size(), 0);
+
+        for(int s = 0; s<shards.size(); s++){
+          if(!shards[s].results[p].empty()){
+            heads.push(make_pair(shards[s].results[p][0], s));
+          }
+        }
+
+        while((results[p].size() < count) && !heads.empty()){
+          Head head = heads.top();
+          heads.pop();
+          results[p].push_back(head.first);
+
+          int s = head.second;
+          if(++position[s] < shards[s].results[p].size()){
+            heads.push(make_pair(shards[s].results[p][position[s]], s));
+          }
+        }
+      }
+    });
+
+    return results;
+  }
+
+  int nodes() const {
+    int count = 0;
+    for(const auto& shard : shards){
+      count = max(count, shard.node + 1);
+    }
+    return count;
+  }
+};
@@ -4,7 +4,9 @@
 #include <matrix.h>
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <fstream>
 #include <regex>
+#include <stdexcept>
 
 using namespace std;
 using namespace cv;
@@ -18,28 +20,140 @@ struct Image {
     @brief constructor method for the Image struct
     @param imagePath path to the location of the jpg image
     @param poolingFactor factor by which the image can be rescaled at (default is 2)
+    @param reducedDecode let the JPEG decoder scale by 1/2, 1/4 or 1/8 when the pooling factor allows it, instead of
+    decoding the full image and resizing it (default is true)
     @returns Image containing the grayscale values of the image in the Matrix struct
     */
-    Image(const char* imagePath, int poolingFactor = 2){
-        Mat img = imread(imagePath, IMREAD_GRAYSCALE);
-        int cols = img.cols;
-        int rows = img.rows;
+    Image(const char* imagePath, int poolingFactor = 2, bool reducedDecode = true){
+        //find the name of the file to add to the image
+        parseName(imagePath, name, imageNumber);
+
+        Mat pooledImg = decodePooled(imagePath, poolingFactor, reducedDecode);
+        int cols = pooledImg.cols;
+        int rows = pooledImg.rows;
+
+        //copy into matrix and create image struct
+        data = shared_ptr<Matrix<float>>(new Matrix<float>(rows, cols));
+
+        for(int i = 0; i < rows; i++){
+            const uchar* Mi = pooledImg.ptr<uchar>(i);
+            for(int j = 0; j < cols; j++){
+                data->operator()(i,j) = static_cast<float>(Mi[j]);
+            }
+        }
+    }
 
-        Mat pooledImg;
+    /*
+    @brief decode and pool a jpg image without converting it to floats, for the 8-bit projection of probes
+    @param imagePath path to the location of the jpg image
+    @param poolingFactor factor by which the image can be rescaled at (default is 2)
+    @param reducedDecode let the JPEG decoder scale by 1/2, 1/4 or 1/8 when the pooling factor allows it (default is true)
+    @returns continuous 8-bit grayscale Mat with the pooled pixels
+    */
+    static Mat decodePooled(const char* imagePath, int poolingFactor = 2, bool reducedDecode = true){
+        if(poolingFactor <= 0){
+            throw domain_error("pooling factor has to be a positive integer");
+        }
+
+        //the decoder scales the IDCT of every 8 by 8 block, so each reduced pixel is the average of a block. That is only
+        //exact if the blocks tile the image, so the reduction has to divide the size of the image as well
+        int fullRows = 0;
+        int fullCols = 0;
+        int reduction = 1;
+        if(reducedDecode && (poolingFactor > 1) && jpegSize(imagePath, fullRows, fullCols)){
+            reduction = decodeReduction(poolingFactor, fullRows, fullCols);
+        }
+
+        int flag = (reduction == 8) ? IMREAD_REDUCED_GRAYSCALE_8 : (reduction == 4) ? IMREAD_REDUCED_GRAYSCALE_4 :
+                   (reduction == 2) ? IMREAD_REDUCED_GRAYSCALE_2 : IMREAD_GRAYSCALE;
+        Mat img = imread(imagePath, flag);
+        if(img.empty()){
+            throw runtime_error(string("could not read ") + imagePath);
+        }
+
+        //the size is the one of the full image pooled by the factor, whatever the decoder already did
+        int cols = (reduction > 1) ? fullCols : img.cols;
+        int rows = (reduction > 1) ? fullRows : img.rows;
+
+        Mat pooledImg = img;
         Size newSize(cols/poolingFactor, rows/poolingFactor);
-        resize(img, pooledImg, newSize, 0, 0, INTER_AREA);
+        if((img.cols != newSize.width) || (img.rows != newSize.height)){
+            resize(img, pooledImg, newSize, 0, 0, INTER_AREA);
+        }
 
-        cols = pooledImg.cols;
-        rows = pooledImg.rows;
+        return pooledImg;
+    }
 
-        //find the name of the file to add to the image
-        string fullPath(imagePath);
-        size_t found = fullPath.find_last_of("/\\");
+    /*
+    @brief largest scale of the JPEG decoder (8, 4 or 2) that divides the pooling factor and the size of the image
+    @param poolingFactor factor by which the image is rescaled
+    @param rows height of the full image
+    @param cols width of the full image
+    @returns the reduction of the decoder, 1 if the image has to be decoded at full resolution
+    */
+    static int decodeReduction(int poolingFactor, int rows, int cols){
+        for(int reduction : {8, 4, 2}){
+            if((poolingFactor % reduction == 0) && (rows % reduction == 0) && (cols % reduction == 0)){
+                return reduction;
+            }
+        }
+        return 1;
+    }
+
+    /*
+    @brief read the size of a JPEG image from its frame header without decoding it
+    @param imagePath path to the location of the jpg image
+    @param rows set to the height of the image
+    @param cols set to the width of the image
+    @returns false if the file is not a JPEG image or has no frame header
+    */
+    static bool jpegSize(const char* imagePath, int& rows, int& cols){
+        ifstream file(imagePath, ios::binary);
+        unsigned char header[2];
+        if(!file.read(reinterpret_cast<char*>(header), 2) || (header[0] != 0xFF) || (header[1] != 0xD8)){
+            return false;
+        }
+
+        //walk the segments up to the start of frame, each one starts with 0xFF, the marker and its length
+        unsigned char segment[4];
+        while(file.read(reinterpret_cast<char*>(segment), 4)){
+            if(segment[0] != 0xFF){
+                return false;
+            }
+            int marker = segment[1];
+            int length = (segment[2] << 8) | segment[3];
+            bool frame = (marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC);
+            if(frame){
+                unsigned char size[5];
+                if(!file.read(reinterpret_cast<char*>(size), 5)){
+                    return false;
+                }
+                rows = (size[1] << 8) | size[2];
+                cols = (size[3] << 8) | size[4];
+                return (rows > 0) && (cols > 0);
+            }
+            if((marker == 0xD9) || (marker == 0xDA) || (length < 2)){
+                return false;
+            }
+            file.seekg(length - 2, ios::cur);
+        }
+
+        return false;
+    }
+
+    /*
+    @brief read the subject and image number from a path like ../images/archive/12_2.jpg
+    @param imagePath path to the location of the jpg image
+    @param name set to the name of the subject ("Unknown" if the path has no file name)
+    @param imageNumber set to the number of the image within its subject (-1 if unknown)
+    */
+    static void parseName(const string& imagePath, string& name, int& imageNumber){
+        size_t found = imagePath.find_last_of("/\\");
         if (found != string::npos) {
-            string filename = fullPath.substr(found + 1); 
+            string filename = imagePath.substr(found + 1); 
             // use regex to match name and number
             smatch match;
-            regex regexPattern("([0-9]+)_([0-9]+)\\.jpg");
+            static const regex regexPattern("([0-9]+)_([0-9]+)\\.jpg"); //compiling the pattern costs more than decoding a face
             if (regex_search(filename, match, regexPattern)) {
                 name = match.str(2);
                 imageNumber = stoi(match.str(1)) % 10;
@@ -51,16 +165,49 @@ struct Image {
             name = "Unknown";
             imageNumber = -1;
         }
-        
-        //copy into matrix and create image struct
-        data = shared_ptr<Matrix<float>>(new Matrix<float>(rows, cols));
+    }
+
+    /*
+    @brief image from pixels that are already decoded
+    @param name name of the subject
+    @param imageNumber number of the image within its subject
+    @param data the grayscale values
+    */
+    Image(const string& name, int imageNumber, std::shared_ptr<Matrix<float>> data)
+        : name(name), imageNumber(imageNumber), data(data) {}
+
+    /*
+    @brief downscale the decoded image by averaging factor by factor blocks (the same as INTER_AREA for integer factors),
+    so several resolutions can be made from a single decode
+    @param poolingFactor factor by which the image is rescaled, remaining rows and columns are dropped
+    @returns Image with the same name and number and the pooled grayscale values
+    */
+    Image pooled(int poolingFactor) const {
+        if(poolingFactor <= 0){
+            throw domain_error("pooling factor has to be a positive integer");
+        }
+        if(poolingFactor == 1){
+            return *this;
+        }
+
+        int rows = data->M / poolingFactor;
+        int cols = data->N / poolingFactor;
+        std::shared_ptr<Matrix<float>> pooledData(new Matrix<float>(rows, cols));
+        float scale = 1.0f / (poolingFactor * poolingFactor);
 
         for(int i = 0; i < rows; i++){
-            const uchar* Mi = img.ptr<uchar>(i);
             for(int j = 0; j < cols; j++){
-                data->operator()(i,j) = static_cast<float>(Mi[j]);
+                float sum = 0.0;
+                for(int di = 0; di < poolingFactor; di++){
+                    for(int dj = 0; dj < poolingFactor; dj++){
+                        sum += data->operator()(i * poolingFactor + di, j * poolingFactor + dj);
+                    }
+                }
+                pooledData->operator()(i, j) = sum * scale;
             }
         }
+
+        return Image(name, imageNumber, pooledData);
     }
 
     /*
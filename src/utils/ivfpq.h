@@ -0,0 +1,441 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include "matrix.h"
+#include "parallel.h"
+#include "gallery.h"
+#include "trace.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define IVFPQ_SHUFFLE 1
+#endif
+
+using namespace std;
+
+/*
+@brief squared euclidean distance of two vectors
+*/
+float squaredDistance(const float* a, const float* b, int dims){
+  float distance = 0.0;
+  for(int c = 0; c<dims; c++){
+    float diff = a[c] - b[c];
+    distance += diff * diff;
+  }
+  return distance;
+}
+
+/*
+@brief index of the closest centroid
+@param point the vector
+@param centroids clusters by dims, one centroid per row
+@param distance set to the squared distance to the closest centroid (optional)
+*/
+int nearestCentroid(const float* point, const Matrix<float>& centroids, float* distance = nullptr){
+  int best = 0;
+  float bestDistance = numeric_limits<float>::max();
+  for(int c = 0; c<centroids.M; c++){
+    float d = squaredDistance(point, centroids.data.get() + size_t(c) * centroids.N, centroids.N);
+    if(d < bestDistance){
+      bestDistance = d;
+      best = c;
+    }
+  }
+  if(distance){
+    *distance = bestDistance;
+  }
+  return best;
+}
+
+/*
+@brief Lloyd's k-means, the assignment step runs in parallel over the points. The centroids start at distinct random
+points, a cluster that loses all its points keeps its centroid
+@param points n by dims, one point per row
+@param clusters amount of centroids (at most n)
+@param iterations amount of assignment and update steps
+@param seed seed of the initial choice of points
+@returns Matrix (clusters by dims) with the centroids
+*/
+Matrix<float> kmeans(const Matrix<float>& points, int clusters, int iterations, int seed = 1){
+  TRACE_SCOPE("kmeans");
+
+  int n = points.M;
+  int dims = points.N;
+  if((clusters <= 0) || (clusters > n)){
+    throw domain_error("k-means needs between 1 and the amount of points clusters");
+  }
+
+  vector<int> order(n);
+  iota(order.begin(), order.end(), 0);
+  mt19937 generator(seed);
+  shuffle(order.begin(), order.end(), generator);
+
+  Matrix<float> centroids(clusters, dims);
+  for(int c = 0; c<clusters; c++){
+    copy(points.data.get() + size_t(order[c]) * dims, points.data.get() + size_t(order[c] + 1) * dims,
+         centroids.data.get() + size_t(c) * dims);
+  }
+
+  vector<int> assignment(n, 0);
+  for(int iteration = 0; iteration<iterations; iteration++){
+    parallelFor(n, double(clusters) * dims, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        assignment[i] = nearestCentroid(points.data.get() + size_t(i) * dims, centroids);
+      }
+    });
+
+    vector<double> sums(size_t(clusters) * dims, 0.0);
+    vector<int> counts(clusters, 0);
+    for(int i = 0; i<n; i++){
+      const float* point = points.data.get() + size_t(i) * dims;
+      double* sum = sums.data() + size_t(assignment[i]) * dims;
+      for(int c = 0; c<dims; c++){
+        sum[c] += point[c];
+      }
+      counts[assignment[i]]++;
+    }
+
+    for(int cluster = 0; cluster<clusters; cluster++){
+      if(counts[cluster] == 0){
+        continue;
+      }
+      for(int c = 0; c<dims; c++){
+        centroids(cluster, c) = float(sums[size_t(cluster) * dims + c] / counts[cluster]);
+      }
+    }
+  }
+
+  return centroids;
+}
+
+/*
+@brief compressed index of projected faces for galleries that do not fit into memory as floats. The faces are split
+into inverted lists by the closest coarse centroid, and the residual to that centroid is product quantized: the
+weights are cut into subspaces and every subspace is stored as the 4 bit index of the closest of 16 centroids, two
+subspaces per byte. A search visits the nprobe closest lists. Per list it builds a lookup table of the distance of the
+probe residual to every subspace centroid (asymmetric distance), quantizes it to 8 bits and adds up the table entries
+of 16 faces at a time with byte shuffles (SSSE3, picked at runtime, with a scalar version that gives the same sums)
+@param dims amount of weights per face
+@param lists amount of inverted lists (coarse centroids)
+@param subspaces amount of product quantizer subspaces (at most dims and 256), a face takes (subspaces + 1) / 2 bytes
+*/
+struct IVFPQIndex {
+  static const int Centroids = 16; //per subspace, 4 bit codes
+  static const int Block = 16; //faces per block of codes
+
+  /*
+  @brief faces of one inverted list, the codes are stored in blocks of 16 faces with the byte of subspace pair p of
+  face i of block b at ((b * pairs) + p) * 16 + i, so one load gives the codes of 16 faces
+  */
+  struct List {
+    vector<int> ids;
+    vector<uint8_t> codes;
+  };
+
+  int dims;
+  int lists;
+  int subspaces;
+  int pairs;
+  vector<int> subspaceBegin;
+  Matrix<float> coarse = Matrix<float>(1, 1);
+  vector<Matrix<float>> codebooks; //per subspace, 16 by the dims of the subspace
+  vector<List> invertedLists;
+  int count = 0;
+  bool trained = false;
+
+  IVFPQIndex(int dims, int lists, int subspaces) : dims(dims), lists(lists), subspaces(subspaces), pairs((subspaces + 1) / 2) {
+    //the 16 bit sums of the scan hold at most 256 table entries of 255
+    if((dims <= 0) || (lists <= 0) || (subspaces <= 0) || (subspaces > min(dims, 256))){
+      throw domain_error("an index needs positive dims and lists and between 1 and min(dims, 256) subspaces");
+    }
+    for(int s = 0; s<=subspaces; s++){
+      subspaceBegin.push_back(dims * s / subspaces);
+    }
+    invertedLists.resize(lists);
+  }
+
+  /*
+  @brief use the byte shuffle kernel when the CPU supports it, can be switched off to compare with the scalar kernel
+  */
+  static bool& shuffleEnabled(){
+    static bool enabled = true;
+    return enabled;
+  }
+
+  static bool shuffleAvailable(){
+#ifdef IVFPQ_SHUFFLE
+    return __builtin_cpu_supports("ssse3");
+#else
+    return false;
+#endif
+  }
+
+  /*
+  @brief learn the coarse centroids and the subspace codebooks
+  @param weights training faces (at least lists and 16 of them, one per row)
+  @param iterations amount of k-means iterations (20 by default)
+  */
+  void train(const Matrix<float>& weights, int iterations = 20){
+    TRACE_SCOPE("train index");
+    if(weights.N != dims){
+      throw domain_error("Matrix dimensions do not match");
+    }
+    if(weights.M < max(lists, int(Centroids))){
+      throw domain_error("an index needs at least as many training faces as lists and subspace centroids");
+    }
+
+    coarse = kmeans(weights, lists, iterations, 1);
+
+    //residuals of the training faces
+    Matrix<float> residuals(weights.M, dims);
+    parallelFor(weights.M, double(lists) * dims, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        const float* face = weights.data.get() + size_t(i) * dims;
+        const float* centroid = coarse.data.get() + size_t(nearestCentroid(face, coarse)) * dims;
+        for(int c = 0; c<dims; c++){
+          residuals(i, c) = face[c] - centroid[c];
+        }
+      }
+    });
+
+    codebooks.clear();
+    for(int s = 0; s<subspaces; s++){
+      int width = subspaceBegin[s + 1] - subspaceBegin[s];
+      Matrix<float> part(weights.M, width);
+      for(int i = 0; i<weights.M; i++){
+        for(int c = 0; c<width; c++){
+          part(i, c) = residuals(i, subspaceBegin[s] + c);
+        }
+      }
+      codebooks.push_back(kmeans(part, Centroids, iterations, 2 + s));
+    }
+
+    trained = true;
+  }
+
+  /*
+  @brief encode faces and append them to their lists
+  @param weights the faces (one per row), they get the ids size() to size() + weights.M - 1
+  */
+  void add(const Matrix<float>& weights){
+    TRACE_SCOPE("add to index");
+    if(!trained){
+      throw runtime_error("the index has to be trained before faces are added");
+    }
+    if(weights.N != dims){
+      throw domain_error("Matrix dimensions do not match");
+    }
+
+    //list and codes of every face in parallel, appended in order afterwards
+    vector<int> assignment(weights.M);
+    vector<uint8_t> codes(size_t(weights.M) * subspaces);
+    parallelFor(weights.M, double(lists + Centroids) * dims, [&](int begin, int end){
+      vector<float> residual(dims);
+      for(int i = begin; i<end; i++){
+        const float* face = weights.data.get() + size_t(i) * dims;
+        assignment[i] = nearestCentroid(face, coarse);
+        const float* centroid = coarse.data.get() + size_t(assignment[i]) * dims;
+        for(int c = 0; c<dims; c++){
+          residual[c] = face[c] - centroid[c];
+        }
+        for(int s = 0; s<subspaces; s++){
+          codes[size_t(i) * subspaces + s] = uint8_t(nearestCentroid(residual.data() + subspaceBegin[s], codebooks[s]));
+        }
+      }
+    });
+
+    for(int i = 0; i<weights.M; i++){
+      List& list = invertedLists[assignment[i]];
+      int position = list.ids.size();
+      if(position % Block == 0){
+        list.codes.resize(list.codes.size() + size_t(pairs) * Block, 0);
+      }
+
+      uint8_t* block = list.codes.data() + size_t(position / Block) * pairs * Block;
+      for(int s = 0; s<subspaces; s++){
+        uint8_t code = codes[size_t(i) * subspaces + s];
+        block[(s / 2) * Block + position % Block] |= (s % 2 == 0) ? code : uint8_t(code << 4);
+      }
+      list.ids.push_back(count + i);
+    }
+    count += weights.M;
+  }
+
+  int size() const {
+    return count;
+  }
+
+  /*
+  @brief bytes of the encoded faces (codes and ids) and of the centroids
+  */
+  size_t bytes() const {
+    size_t total = sizeof(float) * (size_t(coarse.M) * coarse.N);
+    for(const auto& codebook : codebooks){
+      total += sizeof(float) * size_t(codebook.M) * codebook.N;
+    }
+    for(const auto& list : invertedLists){
+      total += list.codes.size() + sizeof(int) * list.ids.size();
+    }
+    return total;
+  }
+
+  /*
+  @brief sums of the quantized table entries of the 16 faces of one block
+  @param table 16 bytes per subspace, pairs * 2 subspaces (the missing odd subspace is all zero)
+  @param block codes of the block
+  @param sums the 16 sums
+  */
+  static void scanBlockScalar(const uint8_t* table, const uint8_t* block, int pairs, uint16_t* sums){
+    for(int i = 0; i<Block; i++){
+      sums[i] = 0;
+    }
+    for(int p = 0; p<pairs; p++){
+      const uint8_t* low = table + (2 * p) * Centroids;
+      const uint8_t* high = table + (2 * p + 1) * Centroids;
+      for(int i = 0; i<Block; i++){
+        uint8_t code = block[p * Block + i];
+        sums[i] += low[code & 0x0F] + high[code >> 4];
+      }
+    }
+  }
+
+#ifdef IVFPQ_SHUFFLE
+  __attribute__((target("ssse3")))
+  static void scanBlockShuffle(const uint8_t* table, const uint8_t* block, int pairs, uint16_t* sums){
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i first = zero;
+    __m128i second = zero;
+
+    for(int p = 0; p<pairs; p++){
+      __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + p * Block));
+      __m128i low = _mm_and_si128(codes, mask);
+      __m128i high = _mm_and_si128(_mm_srli_epi16(codes, 4), mask);
+
+      //16 table lookups per instruction
+      __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + (2 * p) * Centroids)), low);
+      __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + (2 * p + 1) * Centroids)), high);
+
+      first = _mm_add_epi16(first, _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+      second = _mm_add_epi16(second, _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), first);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + 8), second);
+  }
+#endif
+
+  /*
+  @brief find the k closest faces of every probe
+  @param probes the probes (one per row)
+  @param k amount of matches per probe
+  @param nprobe amount of inverted lists visited per probe (8 by default)
+  @returns the matches of every probe sorted by ascending approximate distance
+  */
+  vector<vector<GalleryMatch>> search(const Matrix<float>& probes, int k, int nprobe = 8) const {
+    TRACE_SCOPE("search index");
+    if(probes.N != dims){
+      throw domain_error("Matrix dimensions do not match");
+    }
+    nprobe = max(1, min(nprobe, lists));
+    k = max(k, 1);
+
+#ifdef IVFPQ_SHUFFLE
+    bool shuffle = shuffleEnabled() && shuffleAvailable();
+#endif
+
+    vector<vector<GalleryMatch>> results(probes.M);
+    parallelFor(probes.M, double(count) * nprobe / lists * pairs, [&](int begin, int end){
+      vector<pair<float, int>> closest(lists);
+      vector<float> residual(dims);
+      vector<float> distances(size_t(pairs) * 2 * Centroids);
+      vector<uint8_t> table(size_t(pairs) * 2 * Centroids);
+      uint16_t sums[Block];
+
+      for(int q = begin; q<end; q++){
+        const float* probe = probes.data.get() + size_t(q) * dims;
+        vector<GalleryMatch>& heap = results[q];
+
+        for(int l = 0; l<lists; l++){
+          closest[l] = make_pair(squaredDistance(probe, coarse.data.get() + size_t(l) * dims, dims), l);
+        }
+        partial_sort(closest.begin(), closest.begin() + nprobe, closest.end());
+
+        for(int visit = 0; visit<nprobe; visit++){
+          int l = closest[visit].second;
+          const List& list = invertedLists[l];
+          if(list.ids.empty()){
+            continue;
+          }
+
+          const float* centroid = coarse.data.get() + size_t(l) * dims;
+          for(int c = 0; c<dims; c++){
+            residual[c] = probe[c] - centroid[c];
+          }
+
+          //float table, then 8 bit entries relative to the smallest entry of every subspace
+          fill(distances.begin(), distances.end(), 0.0f);
+          float bias = 0.0;
+          float range = 0.0;
+          for(int s = 0; s<subspaces; s++){
+            int width = subspaceBegin[s + 1] - subspaceBegin[s];
+            float* row = distances.data() + s * Centroids;
+            for(int c = 0; c<Centroids; c++){
+              row[c] = squaredDistance(residual.data() + subspaceBegin[s], codebooks[s].data.get() + c * width, width);
+            }
+            float smallest = *min_element(row, row + Centroids);
+            for(int c = 0; c<Centroids; c++){
+              row[c] -= smallest;
+              range = max(range, row[c]);
+            }
+            bias += smallest;
+          }
+          float scale = (range > 0.0f) ? 255.0f / range : 0.0f;
+          for(int i = 0; i<table.size(); i++){
+            table[i] = uint8_t(min(255.0f, distances[i] * scale + 0.5f));
+          }
+
+          int faces = list.ids.size();
+          for(int first = 0; first<faces; first += Block){
+            const uint8_t* block = list.codes.data() + size_t(first / Block) * pairs * Block;
+#ifdef IVFPQ_SHUFFLE
+            if(shuffle){
+              scanBlockShuffle(table.data(), block, pairs, sums);
+            }
+            else{
+              scanBlockScalar(table.data(), block, pairs, sums);
+            }
+#else
+            scanBlockScalar(table.data(), block, pairs, sums);
+#endif
+
+            for(int i = 0; i<min(int(Block), faces - first); i++){
+              float distance = bias + ((scale > 0.0f) ? sums[i] / scale : 0.0f);
+              GalleryMatch match = {list.ids[first + i], distance};
+              if(heap.size() < k){
+                heap.push_back(match);
+                push_heap(heap.begin(), heap.end());
+              }
+              else if(match < heap.front()){
+                pop_heap(heap.begin(), heap.end());
+                heap.back() = match;
+                push_heap(heap.begin(), heap.end());
+              }
+            }
+          }
+        }
+
+        sort_heap(heap.begin(), heap.end());
+      }
+    });
+
+    return results;
+  }
+};
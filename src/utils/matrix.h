@@ -5,17 +5,105 @@
 #include <cmath>
 #include <tuple>
 #include <omp.h>
+#include <chrono>
+#include "storage.h"
+#include "trace.h"
+#include "progress.h"
+#include "parallel.h"
+#include "blas.h"
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 using namespace std;
 
+/*
+@brief transpose a block of at most 8 by 8 elements
+@param x first element of the source block, its rows are xStride apart
+@param xStride distance between two rows of the source
+@param r first element of the destination block, its rows are rStride apart
+@param rStride distance between two rows of the destination
+@param rows rows of the source block
+@param cols columns of the source block
+*/
+template<typename T>
+void transposeTile(const T* x, int xStride, T* r, int rStride, int rows, int cols){
+  for(int i = 0; i<rows; i++){
+    for(int j = 0; j<cols; j++){
+      r[j * rStride + i] = x[i * xStride + j];
+    }
+  }
+}
+
+#ifdef __SSE__
+/*
+@brief float version of transposeTile that shuffles full 8 by 8 tiles as four 4 by 4 blocks in SSE registers
+*/
+inline void transposeTile(const float* x, int xStride, float* r, int rStride, int rows, int cols){
+  if((rows != 8) || (cols != 8)){
+    for(int i = 0; i<rows; i++){
+      for(int j = 0; j<cols; j++){
+        r[j * rStride + i] = x[i * xStride + j];
+      }
+    }
+    return;
+  }
+
+  for(int bi = 0; bi<8; bi += 4){
+    for(int bj = 0; bj<8; bj += 4){
+      const float* src = x + bi * xStride + bj;
+      __m128 row0 = _mm_loadu_ps(src);
+      __m128 row1 = _mm_loadu_ps(src + xStride);
+      __m128 row2 = _mm_loadu_ps(src + 2 * xStride);
+      __m128 row3 = _mm_loadu_ps(src + 3 * xStride);
+      _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+      float* dst = r + bj * rStride + bi;
+      _mm_storeu_ps(dst, row0);
+      _mm_storeu_ps(dst + rStride, row1);
+      _mm_storeu_ps(dst + 2 * rStride, row2);
+      _mm_storeu_ps(dst + 3 * rStride, row3);
+    }
+  }
+}
+#endif
+
+/*
+@brief cache-oblivious transpose of a rows by cols block. The longer side is halved until the block fits into one tile,
+so at every level of the cache hierarchy both the source and the destination block fit without tuning a block size
+@param x first element of the source block, its rows are xStride apart
+@param xStride distance between two rows of the source
+@param r first element of the destination block, its rows are rStride apart
+@param rStride distance between two rows of the destination
+@param rows rows of the source block
+@param cols columns of the source block
+*/
+template<typename T>
+void transposeBlock(const T* x, int xStride, T* r, int rStride, int rows, int cols){
+  if((rows <= 8) && (cols <= 8)){
+    transposeTile(x, xStride, r, rStride, rows, cols);
+  }
+  else if(rows >= cols){
+    int half = ((rows / 2 + 7) / 8) * 8;
+    transposeBlock(x, xStride, r, rStride, half, cols);
+    transposeBlock(x + half * xStride, xStride, r + half, rStride, rows - half, cols);
+  }
+  else{
+    int half = ((cols / 2 + 7) / 8) * 8;
+    transposeBlock(x, xStride, r, rStride, rows, half);
+    transposeBlock(x + half, xStride, r + half * rStride, rStride, rows, cols - half);
+  }
+}
+
 /*
 @brief Struct for a M by N matrix of type T
 @tparam T type of values stored in the matrix can be int, float or double
+@tparam Order memory layout of the elements, RowMajor (default) or ColMajor so that columns are contiguous
 @param M number of rows
 @param N number of columns
 @param values pointer to array of elements of type T to initialize matrix with values (optional)
 */
-template<typename T>
+template<typename T, StorageOrder Order>
 struct Matrix {
   int M = 0; //rows
   int N = 0; //columns
@@ -25,14 +113,15 @@ struct Matrix {
   @brief constructor method for Matrix
   @param M number of rows
   @param N number of columns
-  @param values pointer to array of elements of type T to initialize matrix with values (optional)
+  @param values pointer to array of elements of type T in the storage order of the matrix to initialize matrix with values (optional)
   */
-  Matrix<T>(int M, int N, const T* values = nullptr) : M(M), N(N){
+  Matrix<T, Order>(int M, int N, const T* values = nullptr) : M(M), N(N){
 	if ((M <= 0) && (N<=0)){
 		throw domain_error("Dimensions of matrix have to be positive integers");
 	}
 
-	data = shared_ptr<T>(new T[M*N](), std::default_delete<T[]>());
+	data = allocateStorage<T>(size_t(M) * N);
+	TRACE_BYTES(sizeof(T) * M * N);
 
 	if (values){
 
@@ -44,7 +133,36 @@ struct Matrix {
   }
 
   /*
-  @brief return the element at the specified position / index in the matrix
+  @brief constructor method for a Matrix that uses existing storage (no copy)
+  @param M number of rows
+  @param N number of columns
+  @param storage array of at least M*N elements in the storage order of the matrix
+  */
+  Matrix<T, Order>(int M, int N, const std::shared_ptr<T>& storage) : M(M), N(N), data(storage){}
+
+  /*
+  @brief distance in memory between two consecutive rows of a column
+  */
+  inline int rowStride() const {
+    return (Order == RowMajor) ? N : 1;
+  }
+
+  /*
+  @brief distance in memory between two consecutive columns of a row
+  */
+  inline int colStride() const {
+    return (Order == RowMajor) ? 1 : M;
+  }
+
+  /*
+  @brief position of the element (row, col) in memory
+  */
+  inline int index(int row, int col) const {
+    return row * rowStride() + col * colStride();
+  }
+
+  /*
+  @brief return the element at the specified position / index in the memory of the matrix
   @param position the index of the element
   @returns element at index of type T
   */
@@ -62,7 +180,7 @@ struct Matrix {
     if(((row > M-1) || (row < 0)) || ((col > N-1) || (col < 0))){
       throw domain_error("invalid row or col index");
     }
-        return data.get()[row * N + col];
+        return data.get()[index(row, col)];
   }
 
   /*
@@ -78,54 +196,142 @@ struct Matrix {
   }
 
   /*
-  @brief multiply two matrices
+  @brief multiply two matrices, the operands can have any storage order and the result has the order of this type
   @param A: Matrix<T> a matrix of type T (A by B)
   @param B: Matrix<T> a matrix of type T (B by C)
   @returns result multiplied matrix of type T (A by C)
   */
-  static Matrix<T> multMat(const Matrix<T> &a, const Matrix<T> &b){
+  template<StorageOrder OrderA, StorageOrder OrderB>
+  static Matrix<T, Order> multMat(const Matrix<T, OrderA> &a, const Matrix<T, OrderB> &b){
 	if(a.N != b.M){
 		throw domain_error("Matrix dimensions do not match");
 	}
 	
 	int result_rows = a.M;
 	int result_cols = b.N;
+	int inner = a.N;
+
+	auto result = Matrix<T, Order>(result_rows, result_cols);
+	TRACE_FLOPS(2.0 * result_rows * result_cols * inner);
+
+	const T* A = a.data.get();
+	const T* B = b.data.get();
+	T* C = result.data.get();
+	int ars = a.rowStride();
+	int acs = a.colStride();
+	int brs = b.rowStride();
+	int bcs = b.colStride();
+
+	//external backend, row-major arrays are the column-major arrays of their transposes so a row-major result is
+	//computed as C^T = B^T * A^T
+	int lda = (OrderA == ColMajor) ? a.M : a.N;
+	int ldb = (OrderB == ColMajor) ? b.M : b.N;
+	if(Order == ColMajor){
+		if(blasGemm(OrderA == RowMajor, OrderB == RowMajor, result_rows, result_cols, inner, A, lda, B, ldb, C, result_rows)){
+			return result;
+		}
+	}
+	else if(blasGemm(OrderB == ColMajor, OrderA == ColMajor, result_cols, result_rows, inner, B, ldb, A, lda, C, result_cols)){
+		return result;
+	}
 
-	auto result = Matrix<T>(result_rows, result_cols);
-
-  #pragma omp parallel for
-	for(int i=0; i<result_rows; i++){
-		for(int j=0; j<result_cols; j++){
-			
-			T prod = T();
-
-			for(int k=0; k<b.M; k++){
-				prod += a(i, k) * b(k, j);
+	if(Order == RowMajor){
+		//rows of the result are independent. With a row-major b each row accumulates a(i,k) * row k of b, with a
+		//column-major b every element is a dot product with a contiguous column, so the inner loop is always contiguous
+		parallelFor(result_rows, double(result_cols) * inner, [&](int begin, int end){
+			for(int i=begin; i<end; i++){
+				T* row = C + i * result_cols;
+
+				if(OrderB == RowMajor){
+					for(int k=0; k<inner; k++){
+						const T aik = A[i * ars + k * acs];
+						const T* bk = B + k * result_cols;
+
+						for(int j=0; j<result_cols; j++){
+							row[j] += aik * bk[j];
+						}
+					}
+				}
+				else{
+					for(int j=0; j<result_cols; j++){
+						const T* bj = B + j * inner;
+						T prod = T();
+
+						for(int k=0; k<inner; k++){
+							prod += A[i * ars + k * acs] * bj[k];
+						}
+						row[j] = prod;
+					}
+				}
 			}
-
-			result(i, j) = prod;
-		}
+		});
+	}
+	else{
+		//same as above with the roles of rows and columns swapped
+		parallelFor(result_cols, double(result_rows) * inner, [&](int begin, int end){
+			for(int j=begin; j<end; j++){
+				T* col = C + j * result_rows;
+
+				if(OrderA == ColMajor){
+					for(int k=0; k<inner; k++){
+						const T bkj = B[k * brs + j * bcs];
+						const T* ak = A + k * result_rows;
+
+						for(int i=0; i<result_rows; i++){
+							col[i] += ak[i] * bkj;
+						}
+					}
+				}
+				else{
+					for(int i=0; i<result_rows; i++){
+						const T* ai = A + i * inner;
+						T prod = T();
+
+						for(int k=0; k<inner; k++){
+							prod += ai[k] * B[k * brs + j * bcs];
+						}
+						col[i] = prod;
+					}
+				}
+			}
+		});
 	}
 
 	return result;
 
   }
 
+  /*
+  @brief multiply a matrix with its own transpose (a * a^T), e.g. the covariance of a face matrix. The external backend
+  only computes one triangle of the symmetric result
+  @param a matrix of type T (A by B)
+  @returns symmetric matrix of type T (A by A)
+  */
+  static Matrix<T, Order> multTransposed(const Matrix<T, Order> &a){
+    Matrix<T, Order> result(a.M, a.M);
+    if(blasSyrk(Order == RowMajor, a.M, a.N, a.data.get(), (Order == ColMajor) ? a.M : a.N, result.data.get())){
+      TRACE_FLOPS(1.0 * a.M * a.M * a.N);
+      return result;
+    }
+    return multMat(a, a.transposedView());
+  }
+
   /*
   @brief multiply matrix with a scalar
-  @param A: Matrix<T> a matrix of type T
+  @param A: Matrix<T, Order> a matrix of type T
   @param scalar: Scalar of type T
   @returns Matrix of type T multiplied with the scalar
   */
-  static Matrix<T> multScalar(const Matrix<T> &a, const T &scalar){
-    auto result = Matrix<T>(a.M, a.N);
-  
-    #pragma omp parallel for
-    for(int i = 0; i<a.M; i++){
-      for(int j = 0; j<a.N; j++){
-        result(i,j) = a(i,j) * scalar;
+  static Matrix<T, Order> multScalar(const Matrix<T, Order> &a, const T &scalar){
+    auto result = Matrix<T, Order>(a.M, a.N);
+    const T* x = a.data.get();
+    T* r = result.data.get();
+
+    parallelFor(a.M * a.N, 1, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        r[i] = x[i] * scalar;
       }
-    }
+    });
 
     return result;
   }
@@ -135,7 +341,8 @@ struct Matrix {
   @param other other matrix of type T to multiply with
   @returns multiplied matrix of type T
   */
-  Matrix<T> operator*(const Matrix<T> &other){
+  template<StorageOrder OtherOrder>
+  Matrix<T, Order> operator*(const Matrix<T, OtherOrder> &other){
 	  return multMat(*this, other);
   }
 
@@ -144,23 +351,96 @@ struct Matrix {
   @param scalar scalar of type T
   @returns multiplied matrix of type T
   */
-  Matrix<T> operator*(const T &scalar){
+  Matrix<T, Order> operator*(const T &scalar){
     return multScalar(*this, scalar);
   }
 
   /*
-  @brief transpose the matrix of type T from M by N to N by M
+  @brief transpose the matrix of type T from M by N to N by M. The copy is done in 8 by 8 tiles of a recursive
+  (cache-oblivious) blocking, so neither the reads nor the writes walk through memory with a large stride
   @returns transposed matrix of type T 
   */
-  Matrix<T> transpose() const {
-    Matrix<T> result(N, M);
-  
-    #pragma omp parallel for
-    for(int i=0; i<M; i++){
-      for(int j=0; j<N; j++){
-        result(j,i) = this->operator()(i,j);
+  Matrix<T, Order> transpose() const {
+    TRACE_SCOPE("transpose");
+    Matrix<T, Order> result(N, M);
+    const T* x = data.get();
+    T* r = result.data.get();
+
+    //the outer dimension is rows for row-major and columns for column-major
+    int outer = (Order == RowMajor) ? M : N;
+    int inner = (Order == RowMajor) ? N : M;
+
+    //bands of whole tiles of the outer dimension are transposed independently
+    int bands = (outer + 7) / 8;
+    parallelFor(bands, 8.0 * inner, [&](int begin, int end){
+      int first = begin * 8;
+      int last = min(end * 8, outer);
+      transposeBlock(x + first * inner, inner, r + first, outer, last - first, inner);
+    });
+    return result;
+  }
+
+  /*
+  @brief transpose the matrix in place. Square matrices swap the tiles above the diagonal with the tiles below it,
+  other shapes are transposed into new storage that replaces the old one
+  */
+  void transposeInPlace(){
+    if(M != N){
+      *this = transpose();
+      return;
+    }
+
+    T* x = data.get();
+    int size = M;
+    int tiles = (size + 7) / 8;
+
+    //a band of tiles only swaps with tiles right of the diagonal, so every pair belongs to exactly one band
+    parallelFor(tiles, 8.0 * size, [&](int begin, int end){
+      for(int ti = begin; ti<end; ti++){
+        for(int tj = ti; tj<tiles; tj++){
+          for(int i = ti * 8; i<min(ti * 8 + 8, size); i++){
+            for(int j = (ti == tj) ? i + 1 : tj * 8; j<min(tj * 8 + 8, size); j++){
+              swap(x[i * size + j], x[j * size + i]);
+            }
+          }
+        }
       }
+    });
+  }
+
+  /*
+  @brief transposed view of the matrix (N by M) without a copy. A row-major matrix read as column-major is its
+  transpose and vice versa, so the view only swaps the storage order and shares the data. multMat reads the view with
+  its strides, writes to the view change this matrix
+  @returns N by M matrix in the opposite storage order that shares the data
+  */
+  Matrix<T, (Order == RowMajor) ? ColMajor : RowMajor> transposedView() const {
+    return Matrix<T, (Order == RowMajor) ? ColMajor : RowMajor>(N, M, data);
+  }
+
+  /*
+  @brief copy the matrix into another storage order (shares the data if the order is the same)
+  @returns matrix with the same elements in the requested order
+  */
+  template<StorageOrder Other>
+  Matrix<T, Other> reorder() const {
+    if(Other == Order){
+      return Matrix<T, Other>(M, N, data);
     }
+
+    Matrix<T, Other> result(M, N);
+    const T* x = data.get();
+    T* r = result.data.get();
+    int outer = (Order == RowMajor) ? M : N;
+    int inner = (Order == RowMajor) ? N : M;
+
+    //changing the order moves the elements exactly like a transpose of the memory
+    int bands = (outer + 7) / 8;
+    parallelFor(bands, 8.0 * inner, [&](int begin, int end){
+      int first = begin * 8;
+      int last = min(end * 8, outer);
+      transposeBlock(x + first * inner, inner, r + first, outer, last - first, inner);
+    });
     return result;
   }
 
@@ -168,38 +448,41 @@ struct Matrix {
   @brief method to change matrix of any type to a matrix of float
   @return Matrix as type float
   */
-  Matrix<float> toFloat() {
-    Matrix<float> result(N,M);
-
-    #pragma omp parallel for
-    for(int i=0; i<M; i++){
-      for(int j=0; j<N; j++){
-        result(i,j) = float(this->operator()(i,j));
+  Matrix<float, Order> toFloat() {
+    Matrix<float, Order> result(M,N);
+    const T* x = data.get();
+    float* r = result.data.get();
+
+    parallelFor(M * N, 1, [&](int begin, int end){
+      for(int i=begin; i<end; i++){
+        r[i] = float(x[i]);
       }
-    }
+    });
 
     return result;
   }
 
   /*
   @brief subract a matrix of type T from another matrix of the same type and dimension
-  @param A: Matrix<T> a matrix of type T (A by B)
-  @param B: Matrix<T> a matrix of type T (A by B)
-  @returns C: Matrix<T> subtracted result of matrix A and B
+  @param A: Matrix<T, Order> a matrix of type T (A by B)
+  @param B: Matrix<T, Order> a matrix of type T (A by B)
+  @returns C: Matrix<T, Order> subtracted result of matrix A and B
   */
-  static Matrix<T> sub(const Matrix<T> &a, const Matrix<T> &b){
+  static Matrix<T, Order> sub(const Matrix<T, Order> &a, const Matrix<T, Order> &b){
 	if((a.M != b.M) || (a.N != b.N)){
 		throw domain_error("Matrix dimensions do not match");
 	}
 
-	auto result = Matrix<T>(a.M, a.N);
+	auto result = Matrix<T, Order>(a.M, a.N);
+	const T* x = a.data.get();
+	const T* y = b.data.get();
+	T* r = result.data.get();
 
-  #pragma omp parallel for
-	for(int i=0; i<a.M; i++){
-		for(int j=0; j<a.N; j++){
-			result(i,j) = a(i,j) - b(i,j);
+	parallelFor(a.M * a.N, 1, [&](int begin, int end){
+		for(int i=begin; i<end; i++){
+			r[i] = x[i] - y[i];
 		}
-	}
+	});
 
 	return result;
   }
@@ -208,30 +491,32 @@ struct Matrix {
   @brief subract one matrix of type T from another matrix of type T 
   @returns subtracted matrix of type T
   */
-  Matrix<T> operator-(const Matrix<T> &other){
+  Matrix<T, Order> operator-(const Matrix<T, Order> &other){
 	  return sub(*this, other);
   }
 
   /*
   @brief add a matrix of type T from another matrix of the same type and dimension. This function uses math based matrix indexing
   so it has to be adjusted for when using the matrix
-  @param A: Matrix<T> a matrix of type T (A by B)
-  @param B: Matrix<T> a matrix of type T (A by B)
-  @returns C: Matrix<T> added result of matrix A and B
+  @param A: Matrix<T, Order> a matrix of type T (A by B)
+  @param B: Matrix<T, Order> a matrix of type T (A by B)
+  @returns C: Matrix<T, Order> added result of matrix A and B
   */
-  static Matrix<T> add(const Matrix<T> &a, const Matrix<T> &b){
+  static Matrix<T, Order> add(const Matrix<T, Order> &a, const Matrix<T, Order> &b){
 	if((a.M != b.M) || (a.N != b.N)){
 		throw domain_error("Matrix dimensions do not match");
 	}
 
-	auto result = Matrix<T>(a.M, a.N);
+	auto result = Matrix<T, Order>(a.M, a.N);
+	const T* x = a.data.get();
+	const T* y = b.data.get();
+	T* r = result.data.get();
 
-  #pragma omp parallel for
-	for(int i=0; i<a.M; i++){
-		for(int j=0; j<a.N; j++){
-			result(i,j) = a(i,j) + b(i,j);
+	parallelFor(a.M * a.N, 1, [&](int begin, int end){
+		for(int i=begin; i<end; i++){
+			r[i] = x[i] + y[i];
 		}
-	}
+	});
 
 	return result;
 
@@ -241,40 +526,51 @@ struct Matrix {
   @brief add one matrix of type T from another matrix of type T 
   @returns added matrix of type T
   */
-  Matrix<T> operator+(const Matrix<T> &other){
+  Matrix<T, Order> operator+(const Matrix<T, Order> &other){
 	  return add(*this, other);
   }
 
   /*
-  @brief return the selected column of a matrix of type T (starting at index 0 to M-1)
-  @returns a Matrix (N, 1) with the values of the column vector
+  @brief return the selected column of a matrix of type T (starting at index 0 to N-1)
+  @returns a Matrix (M, 1) with the values of the column vector
   */
-  Matrix<T> getColumn(int col) {
-    if (col > this->M){
+  Matrix<T, Order> getColumn(int col) {
+    if ((col >= this->N) || (col < 0)){
       throw domain_error("column index out of range");
     }
 
-    auto result = Matrix<T>(this->N, 1);
-    for(int i = 0; i<this->N; i++){
-      result(i,0) = this->operator()(i, col);
+    auto result = Matrix<T, Order>(this->M, 1);
+    const T* x = data.get() + col * colStride();
+    T* r = result.data.get();
+    int stride = rowStride();
+
+    //contiguous for column-major matrices
+    for(int i = 0; i<this->M; i++){
+      r[i] = x[i * stride];
     }
 
     return result;
   }
 
   /*
-  @brief set the selected column of the matrix with a 1D Matrix (starting at index 0 to M-1)
+  @brief set the selected column of the matrix with a 1D Matrix of any storage order (starting at index 0 to N-1)
   */
-  void setColumn(int col, const Matrix<T> &a) {
-    if (col > this->M){
+  template<StorageOrder OtherOrder>
+  void setColumn(int col, const Matrix<T, OtherOrder> &a) {
+    if ((col >= this->N) || (col < 0)){
       throw domain_error("column index out of range");
     }
-    if(a.N > this->N){
+    if((a.M != this->M) || (a.N != 1)){
       throw domain_error("length of vector a does not fit the matrix");
     }
 
-    for(int i = 0; i<this->N; i++){
-      this->operator()(i, col) = a(i,0);
+    const T* x = a.data.get();
+    T* r = data.get() + col * colStride();
+    int stride = rowStride();
+
+    //contiguous for column-major matrices
+    for(int i = 0; i<this->M; i++){
+      r[i * stride] = x[i];
     }
 
   }
@@ -298,7 +594,7 @@ struct Matrix {
   @brief L2 comparison of the matrices (|A-B|^2)
   @returns float of the L2 norm
   */
-  static float L2(const Matrix<T> &a, const Matrix<T> &b){
+  static float L2(const Matrix<T, Order> &a, const Matrix<T, Order> &b){
     if((a.M != b.M) || (a.N != b.N)){
       throw domain_error("Matrix dimensions do not match");
     }
@@ -319,9 +615,9 @@ struct Matrix {
   @brief extract the diagonal elements of the Matrix into a new 1D Matrix
   @returns 1D Matrix of type T with only the diagonal elements
   */
-  Matrix<T> diagonal(){
+  Matrix<T, Order> diagonal(){
     int smallestSide = (this->M >= this->N) ? this->N : this->M;
-    auto result = Matrix<T>(smallestSide, 1);
+    auto result = Matrix<T, Order>(smallestSide, 1);
 
     for(int i=0; i<smallestSide; i++){
       result(i,0) = this->operator()(i,i);
@@ -330,28 +626,42 @@ struct Matrix {
     return result;
   }
 
+  /*
+  @brief calculates the norm of all elements that are not on the diagonal, goes to 0 when the QR iterations converge
+  @returns float norm value
+  */
+  float offDiagonalNorm(){
+    float sum = 0.0;
+
+    for(int i = 0; i < this->M; i++){
+      for(int j = 0; j<this->N; j++){
+        if(i != j){
+          sum += float(this->operator()(i,j)*this->operator()(i,j));
+        }
+      }
+    }
+    return sqrt(sum);
+  }
+
   /*
   @brief create an identity matrix in form of the the reference matrix (has to be square)
   @returns indentity matrix
   */
-  Matrix<T> identity(){
+  Matrix<T, Order> identity(){
     if(this->M != this->N){
       throw domain_error("not a square matrix");
     }
 
-    auto result = Matrix<T>(this->M, this->M);
+    //new matrices are zero initialised so only the diagonal has to be set
+    auto result = Matrix<T, Order>(this->M, this->M);
+    T* r = result.data.get();
+    int size = this->M;
 
-    #pragma omp parallel for
-    for(int i = 0; i<this->M; i++){
-      for(int j = 0; j<this->M; j++){
-        if(i == j){
-          result(i,j) = static_cast<T>(1);
-        }
-        else{
-          result(i,j) = static_cast<T>(0);
-        }
+    parallelFor(size, 1, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        r[i * size + i] = static_cast<T>(1);
       }
-    }
+    });
 
     return result;
   }
@@ -360,16 +670,17 @@ struct Matrix {
   @brief method to divide matrix by a given scalar a/s
   @returns matrix of type T divided by a scalar
   */
-  static Matrix<T> div(const Matrix<T> &a, const T &scalar){
+  static Matrix<T, Order> div(const Matrix<T, Order> &a, const T &scalar){
     
-    auto result = Matrix<T>(a.M, a.N);
+    auto result = Matrix<T, Order>(a.M, a.N);
+    const T* x = a.data.get();
+    T* r = result.data.get();
 
-    #pragma omp parallel for
-    for(int i=0; i<a.M; i++){
-      for(int j=0; j<a.N; j++){
-        result(i,j) = a(i,j) / scalar;
+    parallelFor(a.M * a.N, 1, [&](int begin, int end){
+      for(int i=begin; i<end; i++){
+        r[i] = x[i] / scalar;
       }
-    }
+    });
 
 	  return result;
   }
@@ -378,7 +689,7 @@ struct Matrix {
   @brief operator for dividing matrix by a scalar
   @returns matrix divided by a scalar
   */
-  Matrix<T> operator/(const T &scalar){
+  Matrix<T, Order> operator/(const T &scalar){
 	  return div(*this, scalar);
   }
 
@@ -386,93 +697,98 @@ struct Matrix {
   @brief divide and assign method for matrices
   */
   void operator/=(const T &scalar){
+    T* r = data.get();
 
-    #pragma omp parallel for
-    for(int i=0; i<this->M; i++){
-      for(int j=0; j<this->N; j++){
-        this->operator()(i,j) = this->operator()(i,j) / scalar;
+    parallelFor(this->M * this->N, 1, [&](int begin, int end){
+      for(int i=begin; i<end; i++){
+        r[i] = r[i] / scalar;
       }
-    }
+    });
   }
 
   /*
   @brief subtract and assign method for matrices
   */
-  void operator-=(const Matrix<T> &other){
+  void operator-=(const Matrix<T, Order> &other){
     if(this->N != other.N || this->M != other.M){
       throw domain_error("Matrix dimensions do not match");
     }
 
-    #pragma omp parallel for
-    for(int i = 0; i<this->M; i++){
-      for(int j =0; j<this->N; j++){
-        this->operator()(i,j) = this->operator()(i,j) - other(i,j);
+    T* r = data.get();
+    const T* y = other.data.get();
+
+    parallelFor(this->M * this->N, 1, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        r[i] = r[i] - y[i];
       }
-    }
+    });
   }
 
   /*
   @brief add and assign method for matrices
   */
-  void operator+=(const Matrix<T> &other){
+  void operator+=(const Matrix<T, Order> &other){
     if(this->N != other.N || this->M != other.M){
       throw domain_error("Matrix dimensions do not match");
     }
 
-    #pragma omp parallel for
-    for(int i = 0; i<this->M; i++){
-      for(int j =0; j<this->N; j++){
-        this->operator()(i,j) = this->operator()(i,j) + other(i,j);
+    T* r = data.get();
+    const T* y = other.data.get();
+
+    parallelFor(this->M * this->N, 1, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        r[i] = r[i] + y[i];
       }
-    }
+    });
   }
 
   /*
   @brief Modified Gram-Schmidt process to form an orthonormal basis for matrix. link: https://en.wikipedia.org/wiki/Gram%E2%80%93Schmidt_process
+  The columns are processed in place, so they are read and written contiguously when the matrix is column-major
   @returns Matrix of floats that contain the orthonormal basis
   */
-  Matrix<float> GramSchmidt(){
+  Matrix<float, Order> GramSchmidt(){
+    TRACE_SCOPE("GramSchmidt");
 
-    //copy matrix to be of type float
-    auto temp = this->toFloat();
+    //copy matrix to be of type float, the columns are orthonormalised in place
+    auto result = this->toFloat();
+    float* q = result.data.get();
+    int rows = this->M;
+    int stride = result.rowStride();
+    int colStride = result.colStride();
 
     //dot product for projections
-    auto dotProduct = [](Matrix<float> a, Matrix<float> b){
+    auto dotProduct = [rows, stride](const float* a, const float* b){
 
       float result = 0.0;
 
-      for(int i = 0; i<a.M; i++){
-        result += a(i,0) * b(i,0);
+      for(int i = 0; i<rows; i++){
+        result += a[i * stride] * b[i * stride];
       }
 
       return result;
     };
 
-    //Gram Schmidt process
-    auto result = Matrix<float>(this->M, this->N);
-
-    //first column vector is u1
-    Matrix<float> u1 = temp.getColumn(0);
-    u1 /= u1.norm();
-    result.setColumn(0, u1);
-
     //iterate over every column
-    for(int i = 1; i<this->N; i++){
+    for(int i = 0; i<this->N; i++){
 
-      Matrix<float> vi = temp.getColumn(i);
+      float* vi = q + i * colStride;
 
       //subtract projection of colum on each previous column
       for(int j = 0; j<i; j++){
-        Matrix<float> vj = result.getColumn(j);
+        const float* vj = q + j * colStride;
         float dot = dotProduct(vj, vi);
-        vi -= (vj * dot);
+
+        for(int r = 0; r<rows; r++){
+          vi[r * stride] -= vj[r * stride] * dot;
+        }
       }
 
       //normalize the vector
-      vi /= vi.norm();
-
-      //add vector to result
-      result.setColumn(i, vi);
+      float norm = sqrt(dotProduct(vi, vi));
+      for(int r = 0; r<rows; r++){
+        vi[r * stride] /= norm;
+      }
 
     }
 
@@ -483,25 +799,36 @@ struct Matrix {
   @brief Do QR decomposition using Gram-Schmidt process. link: https://en.wikipedia.org/wiki/QR_decomposition
   @returns tuple of Matrix Q and Matrix R
   */
-  tuple<Matrix<float>, Matrix<float>> QRDecomposition(){
+  tuple<Matrix<float, Order>, Matrix<float, Order>> QRDecomposition(){
+    TRACE_SCOPE("QR");
 
     auto temp = this->toFloat();
 
-    Matrix<float> Q = this->GramSchmidt();
-    Matrix<float> QTranspose = Q.transpose();
+    //the external backend uses Householder reflections, the signs are fixed to match Gram-Schmidt
+    if(Backend::active()){
+      Matrix<float, ColMajor> q = temp.template reorder<ColMajor>();
+      Matrix<float, ColMajor> r(this->N, this->N);
+      if(blasQR(q.M, q.N, q.data.get(), r.data.get())){
+        return make_tuple(q.template reorder<Order>(), r.template reorder<Order>());
+      }
+    }
+
+    Matrix<float, Order> Q = this->GramSchmidt();
 
-    // R = Q^T * A
-    Matrix<float> R = QTranspose*temp;
+    // R = Q^T * A, Q^T is read through a view instead of being copied
+    Matrix<float, Order> R = Matrix<float, Order>::multMat(Q.transposedView(), temp);
 
     //make R upper triangle
-    #pragma omp parallel for
-    for(int i = 0; i<this->M; i++){
-      for(int j = 0; j<this->N; j++){
-        if(i > j){
-          R(i,j) = 0.0;
+    float* r = R.data.get();
+    int cols = R.N;
+
+    parallelFor(R.M, R.N, [&](int begin, int end){
+      for(int i = begin; i<end; i++){
+        for(int j = 0; j<min(i, cols); j++){
+          r[R.index(i, j)] = 0.0;
         }
       }
-    }
+    });
 
     return make_tuple(Q, R);
   }
@@ -509,51 +836,116 @@ struct Matrix {
   /*
   @brief calculate approximations the eigenvalues and eigenvectors using QR decomposition and the Gram-Schmidt process. link: https://people.inf.ethz.ch/arbenz/ewp/Lnotes/chapter4.pdf
   @param iterations amount of iterations to be done (50000 by default)
-  @param progress prints more information about the process for the main loop (false by default)
+  @param progress draws a progress bar for the main loop (false by default)
   @returns returns Matrix E (M by M) containing all the eigenvectors and Matrix e (M by 1) with all the eigenvalues
   */
-  tuple<Matrix<float>, Matrix<float>> eigen(int iterations = 50000, bool progress=false){
-    int width = 50;
+  tuple<Matrix<float, Order>, Matrix<float, Order>> eigen(int iterations = 50000, bool progress=false){
+    if(progress){
+      return eigen(iterations, consoleProgress(), max(iterations / 100, 1));
+    }
+    return eigen(iterations, EigenCallback(), 1);
+  }
 
-    //make copy for float
-    auto temp = this->toFloat();
+  /*
+  @brief calculate approximations the eigenvalues and eigenvectors and report the progress to a callback
+  @param iterations amount of iterations to be done
+  @param callback called every interval iterations and after the last one, stops the iterations when it returns false
+  @param interval amount of iterations between two calls of the callback (at least 1)
+  @returns returns Matrix E (M by M) containing all the eigenvectors and Matrix e (M by 1) with all the eigenvalues
+  */
+  tuple<Matrix<float, Order>, Matrix<float, Order>> eigen(int iterations, const EigenCallback& callback, int interval){
+    if(interval < 1){
+      throw domain_error("callback interval has to be a positive integer");
+    }
+
+    //make copy for float, the iterations work on columns so they run in column-major order
+    auto temp = this->toFloat().template reorder<ColMajor>();
+
+    //symmetric matrices are solved directly by the external backend, the callback is called once with the result
+    if(Backend::active() && (this->M == this->N)){
+      Matrix<float, ColMajor> values(this->M, 1);
+      Matrix<float, ColMajor> vectors(this->M, this->M);
+      auto start = chrono::steady_clock::now();
+
+      if(blasSymmetricEigen(this->M, temp.data.get(), values.data.get(), vectors.data.get())){
+        if(callback){
+          Matrix<float, ColMajor> D(this->M, this->M);
+          for(int j = 0; j<this->M; j++){
+            D[j * this->M + j] = values[j];
+          }
+
+          EigenProgress progress;
+          progress.iteration = iterations;
+          progress.iterations = iterations;
+          progress.elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+          progress.values = &D;
+          progress.vectors = &vectors;
+          callback(progress);
+        }
+        return make_tuple(vectors.template reorder<Order>(), values.template reorder<Order>());
+      }
+      //not symmetric, temp is still untouched
+    }
 
     auto E = temp.identity();
 
-    if(progress){
-      cout << "Progress: [";
+    auto result = resumeEigen(temp, E, 0, iterations, callback, interval);
+    return make_tuple(get<0>(result).template reorder<Order>(), get<1>(result).template reorder<Order>());
+  }
+
+  /*
+  @brief continue the QR iterations of eigen from an earlier state (e.g. a checkpoint)
+  @param temp current iterate whose diagonal converges to the eigenvalues (column-major)
+  @param E current approximation of the eigenvectors (column-major)
+  @param first amount of iterations that were already done
+  @param iterations total amount of iterations to be done
+  @param callback called every interval iterations and after the last one, stops the iterations when it returns false
+  @param interval amount of iterations between two calls of the callback (at least 1)
+  @returns returns Matrix E (M by M) containing all the eigenvectors and Matrix e (M by 1) with all the eigenvalues
+  */
+  static tuple<Matrix<float, ColMajor>, Matrix<float, ColMajor>> resumeEigen(Matrix<float, ColMajor> temp, Matrix<float, ColMajor> E,
+                                                                             int first, int iterations,
+                                                                             const EigenCallback& callback, int interval){
+    if(interval < 1){
+      throw domain_error("callback interval has to be a positive integer");
     }
+    auto start = chrono::steady_clock::now();
+    auto previous = temp.diagonal();
 
-    for(int i = 0; i<iterations; i++){
+    for(int i = first; i<iterations; i++){
+      TRACE_SCOPE("eigen iteration");
       auto decomp = temp.QRDecomposition();
       auto Q = get<0>(decomp);
       auto R = get<1>(decomp);
       temp = R*Q;
       E = E*Q;
 
-      if(progress){
-        int pos = width * int(i/iterations);
-        cout << "\rProgress: [";
-        for(int j = 0; j<width; j++){
-          if(j< pos){
-            cout << "=";
-          }
-          else if(j == pos){
-            cout << ">";
-          }
-          else{
-            cout << " ";
-          }
+      #ifdef TRACE
+      TRACE_COUNTER("off-diagonal norm", temp.offDiagonalNorm());
+      #endif
+
+      //only gather the progress when it is reported
+      if(callback && (((i + 1) % interval == 0) || (i + 1 == iterations))){
+        auto current = temp.diagonal();
+
+        EigenProgress progress;
+        progress.iteration = i + 1;
+        progress.iterations = iterations;
+        progress.offDiagonal = temp.offDiagonalNorm();
+        progress.elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        progress.values = &temp;
+        progress.vectors = &E;
+
+        for(int j = 0; j<current.M; j++){
+          progress.eigenvalueDelta = max(progress.eigenvalueDelta, float(fabs(current(j,0) - previous(j,0))));
         }
-        
+        previous = current;
 
-        cout << "] " << int(i/iterations * 100.0) << "%\r";
-        cout.flush();
+        if(!callback(progress)){
+          break;
+        }
       }
     }
-    if(progress){
-      cout << endl;
-    }
 
     auto e = temp.diagonal();
 
@@ -562,11 +954,12 @@ struct Matrix {
   }
 
   /*
-  @brief method to change the shape of the matrix from M by N to M*N by 1
+  @brief method to change the shape of the matrix from M by N to M*N by 1 (rows one after another for row-major,
+  columns one after another for column-major)
   @returns flattened matrix
   */
-  Matrix<T> flatten(){
-    auto result = Matrix<T>(this->M*this->N, 1);
+  Matrix<T, Order> flatten(){
+    auto result = Matrix<T, Order>(this->M*this->N, 1);
 
     for(int i=0; i<this->M*this->N; i++){
       result[i] = this->operator[](i);
@@ -581,19 +974,31 @@ struct Matrix {
   @param end ending index of the columns to extract (not included)
   @returns matrix with selected columns
   */
-  Matrix<T> slice(int start, int end){
-    if((start < 0) || (end >= this->N) || (start > end)){
+  Matrix<T, Order> slice(int start, int end){
+    if((start < 0) || (end > this->N) || (start > end)){
       throw domain_error("invalid columns");
     }
 
     int newCols = end - start;
-    Matrix<T> result(this->M, newCols);
+    Matrix<T, Order> result(this->M, newCols);
 
-    #pragma omp parallel for
-    for(int i = 0; i<this->M; i++){
-      for(int j = start; j < end; j++){
-        result(i, j - start) = this->operator()(i,j);
-      }
+    const T* x = data.get();
+    T* r = result.data.get();
+    int rows = this->M;
+    int cols = this->N;
+
+    if(Order == ColMajor){
+      //the selected columns are one contiguous block
+      copy(x + start * rows, x + end * rows, r);
+    }
+    else{
+      parallelFor(rows, newCols, [&](int rowBegin, int rowEnd){
+        for(int i = rowBegin; i<rowEnd; i++){
+          for(int j = start; j < end; j++){
+            r[i * newCols + j - start] = x[i * cols + j];
+          }
+        }
+      });
     }
 
     return result;
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+Memory profiling of the Matrix storage is only compiled in when MEMPROFILE is defined (cmake -DMEMPROFILE=ON). Without it
+the storage is allocated directly and all macros expand to nothing.
+
+MEMORY_PHASE(name)     attributes the Matrix storage allocated by this thread until the end of the scope to a phase
+                       (every TRACE_SCOPE is also a phase, loops on the ThreadPool are charged to the phase of the
+                       thread that submitted them)
+MEMORY_RUN(name)       resets the statistics and prints the high-water-mark report at the end of the scope, nested runs
+                       are part of the outermost one
+*/
+#ifdef MEMPROFILE
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+#define MEMORY_PHASE(name) MemoryPhase MEMORY_CONCAT(memoryPhase, __LINE__)(name)
+#define MEMORY_RUN(name) MemoryRun MEMORY_CONCAT(memoryRun, __LINE__)(name)
+#else
+#define MEMORY_PHASE(name)
+#define MEMORY_RUN(name)
+#endif
+
+/*
+@brief allocations of one phase
+@param name name of the phase
+@param allocations amount of allocations
+@param allocatedBytes bytes of all allocations
+@param liveBytes bytes allocated in the phase that are not freed yet
+@param peakBytes highest liveBytes of the phase
+@param highWaterBytes highest amount of live bytes of all phases reached by an allocation of the phase
+*/
+struct MemoryPhaseStats {
+    string name;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    int64_t liveBytes = 0;
+    int64_t peakBytes = 0;
+    int64_t highWaterBytes = 0;
+};
+
+/*
+@brief live and peak bytes, allocation counts and a histogram of the allocation sizes of the Matrix storage, attributed
+to the phase that is active on the allocating thread. Storage is charged back to the phase that allocated it when it is
+freed, so the live bytes of a phase are what it left behind
+*/
+struct MemoryProfile {
+    static const int Buckets = 40; //powers of two up to 512 GB
+
+    mutex m;
+    vector<MemoryPhaseStats> phases;
+    map<string, int> phaseIndex;
+    int64_t liveBytes = 0;
+    int64_t peakBytes = 0;
+    int peakPhase = 0; //phase that was active when the peak was reached
+    uint64_t histogram[Buckets] = {};
+
+    MemoryProfile(){
+        phase("(no phase)");
+    }
+
+    static MemoryProfile& instance(){
+        static MemoryProfile profile;
+        return profile;
+    }
+
+    /*
+    @brief phases entered by the calling thread, the innermost is charged
+    */
+    static vector<int>& stack(){
+        thread_local vector<int> phases;
+        return phases;
+    }
+
+    /*
+    @brief phase that is charged for the allocations of the calling thread
+    */
+    static int current(){
+        return stack().empty() ? 0 : stack().back();
+    }
+
+    /*
+    @brief index of a phase, registered on first use
+    */
+    int phase(const string& name){
+        auto found = phaseIndex.find(name);
+        if(found != phaseIndex.end()){
+            return found->second;
+        }
+        MemoryPhaseStats stats;
+        stats.name = name;
+        phases.push_back(stats);
+        phaseIndex[name] = phases.size() - 1;
+        return phases.size() - 1;
+    }
+
+    static int bucket(size_t bytes){
+        int b = 0;
+        while((b + 1 < Buckets) && ((size_t(1) << b) < bytes)){
+            b++;
+        }
+        return b;
+    }
+
+    /*
+    @brief record an allocation of the calling thread
+    @param bytes size of the allocation
+    @returns phase the allocation is charged to, pass it to released
+    */
+    int allocated(size_t bytes){
+        int phase = current();
+        lock_guard<mutex> lock(m);
+        MemoryPhaseStats& stats = phases[phase];
+        stats.allocations++;
+        stats.allocatedBytes += bytes;
+        stats.liveBytes += bytes;
+        stats.peakBytes = max(stats.peakBytes, stats.liveBytes);
+        histogram[bucket(bytes)]++;
+
+        liveBytes += bytes;
+        stats.highWaterBytes = max(stats.highWaterBytes, liveBytes);
+        if(liveBytes > peakBytes){
+            peakBytes = liveBytes;
+            peakPhase = phase;
+        }
+        return phase;
+    }
+
+    /*
+    @brief record that an allocation was freed
+    @param bytes size of the allocation
+    @param phase the phase returned by allocated
+    */
+    void released(size_t bytes, int phase){
+        lock_guard<mutex> lock(m);
+        phases[phase].liveBytes -= bytes;
+        liveBytes -= bytes;
+    }
+
+    /*
+    @brief forget the counts of earlier runs, the live bytes stay and become the baseline of the peaks
+    */
+    void reset(){
+        lock_guard<mutex> lock(m);
+        for(auto& stats : phases){
+            stats.allocations = 0;
+            stats.allocatedBytes = 0;
+            stats.peakBytes = stats.liveBytes;
+            stats.highWaterBytes = 0;
+        }
+        peakBytes = liveBytes;
+        peakPhase = current();
+        fill(histogram, histogram + Buckets, 0);
+    }
+
+    static string formatBytes(double bytes){
+        const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+        int unit = 0;
+        while((bytes >= 1024.0) && (unit < 4)){
+            bytes /= 1024.0;
+            unit++;
+        }
+        ostringstream out;
+        out << fixed << setprecision(unit == 0 ? 0 : 1) << bytes << " " << units[unit];
+        return out.str();
+    }
+
+    /*
+    @brief print the peak bytes, the phase that reached it, every phase that allocated and the size histogram
+    @param name name of the run
+    */
+    void report(const string& name, ostream& out = cout){
+        lock_guard<mutex> lock(m);
+        out << "===== Memory of " << name << ": peak " << formatBytes(peakBytes) << " in " << phases[peakPhase].name
+            << ", " << formatBytes(liveBytes) << " live =====" << endl;
+        out << setw(20) << "phase" << setw(10) << "allocs" << setw(14) << "allocated" << setw(14) << "peak own"
+            << setw(14) << "high water" << setw(14) << "live" << endl;
+
+        for(const auto& stats : phases){
+            if((stats.allocations == 0) && (stats.liveBytes == 0)){
+                continue;
+            }
+            out << setw(20) << stats.name << setw(10) << stats.allocations << setw(14) << formatBytes(stats.allocatedBytes)
+                << setw(14) << formatBytes(stats.peakBytes) << setw(14) << formatBytes(stats.highWaterBytes)
+                << setw(14) << formatBytes(stats.liveBytes) << endl;
+        }
+
+        out << "allocation sizes:";
+        for(int b = 0; b<Buckets; b++){
+            if(histogram[b] > 0){
+                out << " <=" << formatBytes(double(size_t(1) << b)) << ": " << histogram[b];
+            }
+        }
+        out << endl;
+    }
+};
+
+/*
+@brief charges the allocations of the calling thread to a phase until it is destroyed
+*/
+struct MemoryPhase {
+    MemoryPhase(const char* name){
+        MemoryProfile& profile = MemoryProfile::instance();
+        int index;
+        {
+            lock_guard<mutex> lock(profile.m);
+            index = profile.phase(name);
+        }
+        MemoryProfile::stack().push_back(index);
+    }
+
+    /*
+    @brief continue a phase of another thread (e.g. the thread that submitted a parallel loop)
+    @param index index of the phase
+    */
+    MemoryPhase(int index){
+        MemoryProfile::stack().push_back(index);
+    }
+
+    ~MemoryPhase(){
+        MemoryProfile::stack().pop_back();
+    }
+};
+
+/*
+@brief resets the profile when the outermost run starts and prints its report when it ends
+*/
+struct MemoryRun {
+    static int& depth(){
+        thread_local int runs = 0;
+        return runs;
+    }
+
+    string name;
+    MemoryPhase phase;
+
+    MemoryRun(const char* name) : name(name), phase(name) {
+        if(depth()++ == 0){
+            MemoryProfile::instance().reset();
+        }
+    }
+
+    ~MemoryRun(){
+        if(--depth() == 0){
+            MemoryProfile::instance().report(name);
+        }
+    }
+};
+
+/*
+@brief zero initialised storage that is counted by a profile until the last owner releases it
+@param count amount of elements
+@param profile the profile that counts the storage
+*/
+template<typename T>
+shared_ptr<T> profiledStorage(size_t count, MemoryProfile& profile){
+    size_t bytes = sizeof(T) * count;
+    int phase = profile.allocated(bytes);
+    return shared_ptr<T>(new T[count](), [bytes, phase, &profile](T* values){
+        delete[] values;
+        profile.released(bytes, phase);
+    });
+}
+
+/*
+@brief zero initialised storage of a Matrix, counted by the MemoryProfile if MEMPROFILE is defined
+@param count amount of elements
+*/
+template<typename T>
+shared_ptr<T> allocateStorage(size_t count){
+#ifdef MEMPROFILE
+    return profiledStorage<T>(count, MemoryProfile::instance());
+#else
+    return shared_ptr<T>(new T[count](), std::default_delete<T[]>());
+#endif
+}
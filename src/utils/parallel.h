@@ -0,0 +1,231 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <omp.h>
+#include "memprofile.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+/*
+@brief persistent pool of worker threads that split a range into chunks. Workers sleep between loops and take chunks
+from a shared counter, the calling thread works on the chunks as well
+@param threads total amount of threads including the calling thread
+@param pin pin every worker to its own core (Linux only)
+*/
+struct ThreadPool {
+  vector<thread> workers;
+  mutex m;
+  mutex submit;
+  condition_variable wake;
+  condition_variable finished;
+  const function<void(int, int)>* task = nullptr;
+  atomic<int> next;
+  int end = 0;
+  int chunk = 1;
+  int generation = 0;
+  int running = 0;
+  int memoryPhase = 0; //phase of the thread that submitted the loop, the workers allocate on its behalf
+  bool stop = false;
+
+  ThreadPool(int threads, bool pin) : next(0) {
+    start(threads, pin);
+  }
+
+  ~ThreadPool(){
+    shutdown();
+  }
+
+  /*
+  @brief true on the worker threads, used to run nested loops serially
+  */
+  static bool& isWorker(){
+    thread_local bool worker = false;
+    return worker;
+  }
+
+  int size() const {
+    return workers.size() + 1;
+  }
+
+  void start(int threads, bool pin){
+    stop = false;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    vector<int> cpus;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+      if(CPU_ISSET(cpu, &allowed)){
+        cpus.push_back(cpu);
+      }
+    }
+#endif
+
+    //workers start at the current generation so they only pick up loops submitted after this point
+    int current = generation;
+    for(int i = 1; i<threads; i++){
+      workers.emplace_back([this, current](){ loop(current); });
+
+#ifdef __linux__
+      if(pin && !cpus.empty()){
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[i % cpus.size()], &set);
+        pthread_setaffinity_np(workers.back().native_handle(), sizeof(set), &set);
+      }
+#endif
+    }
+  }
+
+  void shutdown(){
+    {
+      lock_guard<mutex> lock(m);
+      stop = true;
+    }
+    wake.notify_all();
+    for(auto& worker : workers){
+      worker.join();
+    }
+    workers.clear();
+  }
+
+  void loop(int seen){
+    isWorker() = true;
+
+    unique_lock<mutex> lock(m);
+    while(true){
+      wake.wait(lock, [&](){ return stop || (generation != seen); });
+      if(stop){
+        return;
+      }
+      seen = generation;
+      const function<void(int, int)>* f = task;
+#ifdef MEMPROFILE
+      MemoryPhase submitted(memoryPhase);
+#endif
+      lock.unlock();
+
+      work(*f);
+
+      lock.lock();
+      if(--running == 0){
+        finished.notify_one();
+      }
+    }
+  }
+
+  void work(const function<void(int, int)>& f){
+    while(true){
+      int begin = next.fetch_add(chunk);
+      if(begin >= end){
+        break;
+      }
+      f(begin, min(begin + chunk, end));
+    }
+  }
+
+  /*
+  @brief run f on all chunks of [0, size) and wait until they are done
+  @param size end of the range
+  @param chunkSize amount of items per chunk
+  @param f function called with the begin and end of each chunk
+  @returns false without running anything if another loop is using the pool
+  */
+  bool run(int size, int chunkSize, const function<void(int, int)>& f){
+    unique_lock<mutex> guard(submit, try_to_lock);
+    if(!guard.owns_lock()){
+      return false;
+    }
+
+    {
+      lock_guard<mutex> lock(m);
+      task = &f;
+      end = size;
+      chunk = chunkSize;
+      next.store(0);
+#ifdef MEMPROFILE
+      memoryPhase = MemoryProfile::current();
+#endif
+      running = workers.size();
+      generation++;
+    }
+    wake.notify_all();
+
+    work(f);
+
+    unique_lock<mutex> lock(m);
+    finished.wait(lock, [this](){ return running == 0; });
+    return true;
+  }
+};
+
+/*
+@brief execution policy for the Matrix kernels. Loops with less work than the grain run serially as one contiguous
+(vectorizable) loop, larger loops are split into chunks of at least one grain and run on the thread pool
+*/
+struct Parallel {
+
+  /*
+  @brief minimum amount of work (elements or multiply-adds) per chunk, can be tuned at runtime
+  */
+  static int& grain(){
+    static int g = 1 << 15;
+    return g;
+  }
+
+  static ThreadPool& pool(){
+    static ThreadPool p(omp_get_max_threads(), true);
+    return p;
+  }
+
+  /*
+  @brief change the amount of threads of the pool (must not be called while a loop is running)
+  @param threads total amount of threads including the calling thread
+  @param pin pin the workers to cores (true by default)
+  */
+  static void configure(int threads, bool pin = true){
+    pool().shutdown();
+    pool().start(max(threads, 1), pin);
+  }
+
+  static int threads(){
+    return pool().size();
+  }
+};
+
+/*
+@brief run f(begin, end) over the items [0, size) with the execution policy
+@param size amount of independent items (e.g. elements or rows)
+@param workPerItem estimated work of one item (e.g. 1 per element or the length of a row)
+@param f function called with the begin and end of a range of items
+*/
+template<typename F>
+void parallelFor(int size, double workPerItem, F f){
+  double work = size * workPerItem;
+  int grain = Parallel::grain();
+
+  //small loops, nested loops and loops inside OpenMP regions run serially
+  if((work < 2.0 * grain) || (size < 2) || ThreadPool::isWorker() || omp_in_parallel() || (Parallel::threads() == 1)){
+    f(0, size);
+    return;
+  }
+
+  int chunks = min(int(work / grain), Parallel::threads() * 4);
+  int chunkSize = max((size + chunks - 1) / chunks, 1);
+
+  function<void(int, int)> task = f;
+  if(!Parallel::pool().run(size, chunkSize, task)){
+    f(0, size);
+  }
+}
@@ -5,41 +5,208 @@
 #include <tuple>
 #include "matrix.h"
 #include "image.h"
+#include "trace.h"
+#include "checkpoint.h"
+#include "face.h"
+#include "shard.h"
+#include "cache.h"
 
 using namespace std;
 
 /*
-@brief function to read all the data from the images folder and returns training and testing sets 
-@param split amount of the images to be used as training data (deafult is 0.5)
+@brief paths of all the images of the dataset, image i of subject s is ../images/archive/i_s.jpg
+@returns vector<string> with the 410 paths
+*/
+vector<string> imagePaths(){
+    vector<string> paths;
+
+    int subject = 1;
+    for(int i = 1; i < 411; i++){
+        paths.push_back("../images/archive/" + to_string(i) + "_" + to_string(subject) + ".jpg");
+
+        //update subject at the end
+        if(i%10 == 0){
+            subject++;
+        }
+    }
+
+    return paths;
+}
+
+/*
+@brief function to read all the images from the images folder
 @param poolingFactor to compress the image (default is 2)
+@returns vector<Image> with every image of the dataset
+*/
+vector<Image> loadImages(int poolingFactor = 2){
+    TRACE_SCOPE("load");
+
+    vector<Image> images;
+    for(const auto& path : imagePaths()){
+        images.push_back(Image(path.c_str(), poolingFactor));
+    }
+
+    return images;
+}
+
+/*
+@brief decides if an image is part of the training set
+@param imageNumber number of the image within its subject (0 to 9, negative if unknown)
+@param split amount of the images to be used as training data
+@param fold rotates which image numbers of each subject are used for training, shifting the window by the size of the test set per fold
+@returns true for training images
+*/
+bool isTrainingImage(int imageNumber, float split, int fold){
+    int trainPerSubject = int(split*10);
+    int offset = fold * (10 - trainPerSubject);
+    int slot = (imageNumber < 0) ? imageNumber : (imageNumber + offset) % 10;
+
+    return slot <= trainPerSubject - 1;
+}
+
+/*
+@brief function to split already loaded images into training and testing sets
+@param images the images to split
+@param split amount of the images to be used as training data (deafult is 0.5)
+@param fold rotates which image numbers of each subject are used for training, shifting the window by the size of the test set per fold (default is 0)
 @returns tuple of vector<Image> of train and test
 */
-tuple<vector<Image>, vector<Image>> createData(float split = 0.5, int poolingFactor = 2){
+tuple<vector<Image>, vector<Image>> splitData(const vector<Image>& images, float split = 0.5, int fold = 0){
+    TRACE_SCOPE("split");
 
     vector<Image> train;
     vector<Image> test;
 
-    int subject = 1;
-    for(int i = 1; i < 411; i++){
-
-        //create path
-        string path = "../images/archive/" + to_string(i) + "_" + to_string(subject) + ".jpg";
-        auto image = Image(path.c_str(), poolingFactor);
-
-        if(image.imageNumber <= int(split*10) - 1){
+    for(const auto& image : images){
+        if(isTrainingImage(image.imageNumber, split, fold)){
             train.push_back(image);
         }
         else{
             test.push_back(image);
         }
+    }
 
-        //update subject at the end
-        if(i%10 == 0){
-            subject++;
+    return make_tuple(train, test);
+}
+
+/*
+@brief paths of the training images without decoding them, the same images splitData puts into the training set
+@param split amount of the images to be used as training data (deafult is 0.5)
+@param fold rotates which image numbers of each subject are used for training (default is 0)
+@returns vector<string> with the paths of the training images
+*/
+vector<string> trainingPaths(float split = 0.5, int fold = 0){
+    auto paths = imagePaths();
+    vector<string> train;
+
+    //image i of the dataset has the number i % 10 within its subject
+    for(int i = 0; i<paths.size(); i++){
+        if(isTrainingImage((i + 1) % 10, split, fold)){
+            train.push_back(paths[i]);
         }
     }
 
-    return make_tuple(train, test);
+    return train;
+}
+
+/*
+@brief function to read all the data from the images folder and returns training and testing sets 
+@param split amount of the images to be used as training data (deafult is 0.5)
+@param poolingFactor to compress the image (default is 2)
+@returns tuple of vector<Image> of train and test
+*/
+tuple<vector<Image>, vector<Image>> createData(float split = 0.5, int poolingFactor = 2){
+    TRACE_SCOPE("createData");
+    return splitData(loadImages(poolingFactor), split);
+}
+
+/*
+@brief calculate the average face vector sum(face vectors)/number(vectors)
+@param data the images to average
+@returns Matrix (M*N by 1) with the average face
+*/
+Matrix<float> meanFace(const vector<Image>& data){
+    TRACE_SCOPE("mean");
+    int M = data[0].data->M;
+    int N = data[0].data->N;
+
+    Matrix<float> averageFaceVector(M*N, 1);
+    auto kernels = faceKernels(M, N);
+
+    for(const auto& image : data){
+        if((image.data->M != M) || (image.data->N != N)){
+            throw domain_error("Matrix dimensions do not match");
+        }
+        //row-major images are already flat
+        kernels.accumulate(image.data->data.get(), averageFaceVector.data.get(), kernels.pixels);
+    }
+
+    averageFaceVector /= data.size();
+
+    return averageFaceVector;
+}
+
+/*
+@brief subtract the average face vector from all images and stack them as columns of a matrix
+@param data the images to use
+@param averageFaceVector the average face (M*N by 1)
+@returns column-major Matrix (M*N by number of images) with one mean centered face per contiguous column
+*/
+Matrix<float, ColMajor> faceMatrix(const vector<Image>& data, const Matrix<float>& averageFaceVector){
+    TRACE_SCOPE("face matrix");
+    Matrix<float, ColMajor> A(averageFaceVector.M, data.size());
+    if(data.empty()){
+        return A;
+    }
+
+    auto kernels = faceKernels(data[0].data->M, data[0].data->N);
+    if(kernels.pixels != averageFaceVector.M){
+        throw domain_error("Matrix dimensions do not match");
+    }
+
+    for(int i = 0; i<data.size(); i++){
+        if((data[i].data->M != kernels.rows) || (data[i].data->N != kernels.cols)){
+            throw domain_error("Matrix dimensions do not match");
+        }
+        //centered straight into the contiguous column of A
+        kernels.center(data[i].data->data.get(), averageFaceVector.data.get(), A.data.get() + i * A.M, kernels.pixels);
+    }
+
+    return A;
+}
+
+/*
+@brief eigendecomposition of the covariance matrix
+@param C the covariance matrix (M*N by M*N)
+@param verbose print more information about background processes
+@param iterations amount of QR iterations for the eigendecomposition
+@param checkpoint path of a file to periodically save the eigendecomposition to and resume it from (disabled if empty)
+@returns column-major Matrix E (M*N by M*N) with all the eigenvectors and Matrix e (M*N by 1) with all the eigenvalues
+*/
+tuple<Matrix<float, ColMajor>, Matrix<float, ColMajor>> decomposeCovariance(Matrix<float, ColMajor>& C, bool verbose, int iterations,
+                                                                            const string& checkpoint){
+    if(verbose){
+        cout << "===== Find Eigenvectors and Values =====" << endl;
+        cout << "Dimensions of C: " << C.M << " by " << C.N << endl; 
+    }
+
+    TRACE_SCOPE("eigen");
+    int interval = max(iterations / 100, 1);
+    EigenCallback progress = verbose ? consoleProgress() : EigenCallback();
+    return checkpoint.empty() ? C.eigen(iterations, progress, interval)
+                              : checkpointedEigen(C, iterations, checkpoint, interval, progress, verbose);
+}
+
+/*
+@brief choose the eigenvectors of the k largest eigenvalues so that we reduce the dimensionality
+@param E column-major matrix with all the eigenvectors
+@param k amount of eigenvectors to use
+@returns Matrix<float> with the k-highest eigenvectors
+*/
+Matrix<float> eigenfaces(Matrix<float, ColMajor>& E, int k){
+    //the columns of E are contiguous
+    TRACE_SCOPE("slice");
+    return E.slice(0, k).reorder<RowMajor>();
 }
 
 /*
@@ -47,14 +214,31 @@ tuple<vector<Image>, vector<Image>> createData(float split = 0.5, int poolingFac
 @param trainData the training data extracted from the images
 @param k amount of eigenvectors to use (default is 100)
 @param verbose print more information about background processes (false by default)
-@returns tuple<Matrix<float>, Matrix<float> of the average faces and the k-highest eigenvectors
+@param iterations amount of QR iterations for the eigendecomposition (50000 by default)
+@param checkpoint path of a file to periodically save the eigendecomposition to and resume it from (disabled by default)
+@param cache cache of earlier decompositions, a run that only differs in k is served from it (disabled by default)
+@returns Matrix<float> with the k-highest eigenvectors
 */
-Matrix<float> Train(vector<Image> trainData, int k=100, bool verbose=false){
-    
-    
+Matrix<float> Train(vector<Image> trainData, int k=100, bool verbose=false, int iterations=50000, string checkpoint="",
+                    TrainingCache* cache=nullptr){
+    MEMORY_RUN("Train");
+    TRACE_SCOPE("Train");
 
     int M = trainData[0].data->M;
-    int N = trainData[1].data->N;
+    int N = trainData[0].data->N;
+
+    TrainingArtifacts artifacts;
+    if(cache){
+        TRACE_SCOPE("cache lookup");
+        artifacts.key = trainingKey(trainData, iterations);
+
+        if(cache->lookup(artifacts.key, artifacts)){
+            if(verbose){
+                cout << "===== Eigenfaces loaded from " << cache->path(artifacts.key) << " =====" << endl;
+            }
+            return eigenfaces(artifacts.basis, k);
+        }
+    }
 
     if(verbose){
         cout << "===== Creating Face Matrix =====" << endl;
@@ -63,51 +247,63 @@ Matrix<float> Train(vector<Image> trainData, int k=100, bool verbose=false){
     }
 
     //calculate the average face vector
-    //sum(face vectors)/number(vectors)
-    Matrix<float> averageFaceVector(M*N, 1);
-
-    for(const auto& image : trainData){
-        Matrix<float>& imageData = *(image.data);
-        auto flattenedData = imageData.flatten();
-        averageFaceVector += flattenedData;
-    }
-
-    averageFaceVector /= trainData.size();
+    Matrix<float> averageFaceVector = meanFace(trainData);
 
     //subtract average face vector from all data and create matrix
-    Matrix<float> A(M*N, trainData.size());
-
     if(verbose){
         cout << "Dimensions of face matrix A = " << M*N << " by " << trainData.size() << endl;
     }
 
-    for(int i = 0; i<trainData.size(); i++){
-        Matrix<float>& imageData = *(trainData[i].data);
-        auto flattenedData = imageData.flatten();
-
-        flattenedData -= averageFaceVector;
-        A.setColumn(i, flattenedData);
-    }
+    Matrix<float, ColMajor> A = faceMatrix(trainData, averageFaceVector);
 
     if(verbose){
         cout << "===== Calculate Cov. Matrix =====" << endl;
     }
-    //C = A*A^T
+    //C = A*A^T, A^T is never copied (the external backend only computes one triangle)
 
-    Matrix<float> AT = A.transpose();
-    Matrix<float> C = A*AT;
+    Matrix<float, ColMajor> C(1, 1);
+    {
+        TRACE_SCOPE("covariance");
+        C = Matrix<float, ColMajor>::multTransposed(A);
+    }
 
-    if(verbose){
-        cout << "===== Find Eigenvectors and Values =====" << endl;
-        cout << "Dimensions of C: " << C.M << " by " << C.N << endl; 
+    auto decomposition = decomposeCovariance(C, verbose, iterations, checkpoint);
+
+    if(cache){
+        TRACE_SCOPE("cache store");
+        artifacts.mean = averageFaceVector;
+        artifacts.basis = get<0>(decomposition);
+        artifacts.values = get<1>(decomposition);
+        cache->store(artifacts);
     }
 
-    auto result = C.eigen(50000, verbose);
-    auto E = get<0>(result);
-    auto e = get<1>(result);
+    return eigenfaces(get<0>(decomposition), k);
+}
+
+/*
+@brief trains like Train, but the images are decoded and the covariance is accumulated by worker processes that
+share their partial results through shared memory (see shardedCovariance)
+@param paths paths of the training images
+@param poolingFactor to compress the image (default is 2)
+@param workers amount of worker processes (default is 4)
+@param k amount of eigenvectors to use (default is 100)
+@param verbose print more information about background processes (false by default)
+@param iterations amount of QR iterations for the eigendecomposition (50000 by default)
+@param checkpoint path of a file to periodically save the eigendecomposition to and resume it from (disabled by default)
+@returns Matrix<float> with the k-highest eigenvectors
+*/
+Matrix<float> TrainSharded(const vector<string>& paths, int poolingFactor = 2, int workers = 4, int k=100, bool verbose=false,
+                           int iterations=50000, string checkpoint=""){
+    MEMORY_RUN("Train");
+    TRACE_SCOPE("Train");
+
+    if(verbose){
+        cout << "===== Calculate Cov. Matrix with " << workers << " worker processes =====" << endl;
+        cout << "Amount of training data = " << paths.size() << endl;
+    }
 
-    //choose eigenvectors so that we reduce the dimensionality
-    auto Vk = E.slice(0, k);
+    auto sharded = shardedCovariance(paths, poolingFactor, workers);
 
-    return Vk;
+    auto decomposition = decomposeCovariance(sharded.covariance, verbose, iterations, checkpoint);
+    return eigenfaces(get<0>(decomposition), k);
 }
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include "matrix.h"
+#include "image.h"
+#include "pca.h"
+#include "parallel.h"
+#include "blas.h"
+#include "trace.h"
+
+using namespace std;
+
+/*
+@brief ways to find the leading eigenvectors of the covariance of a face matrix A (pixels by images)
+FullCovariance decomposes C = A * A^T (pixels by pixels) completely, GramMatrix decomposes A^T * A (images by images) and
+maps its eigenvectors back with A, IterativeTopK runs a subspace iteration for the k leading eigenvectors only
+*/
+enum TrainingStrategy { FullCovariance, GramMatrix, IterativeTopK };
+
+string strategyName(TrainingStrategy strategy){
+    switch(strategy){
+        case FullCovariance: return "covariance";
+        case GramMatrix: return "gram";
+        default: return "iterative";
+    }
+}
+
+/*
+@brief resources the planner may use and the parameters of the iterative solver
+@param memoryBytes upper bound of the estimated peak memory of a plan (1 GB by default)
+@param cores amount of cores the parallel kernels run on (the threads of the pool by default)
+@param flopsPerCore floating point operations per second of one core, used to turn flops into seconds
+@param sweeps amount of subspace iterations of IterativeTopK (30 by default)
+@param oversampling extra vectors of the subspace iteration, they speed up the convergence of the k-th vector (8 by default)
+@param ritzIterations QR iterations of the small Rayleigh-Ritz problem of IterativeTopK with the built-in kernels (200 by default)
+*/
+struct TrainingBudget {
+    double memoryBytes = double(1 << 30);
+    int cores = Parallel::threads();
+    double flopsPerCore = 2e9;
+    int sweeps = 30;
+    int oversampling = 8;
+    int ritzIterations = 200;
+
+    /*
+    @brief budget with flopsPerCore measured by a matrix product on the current machine and backend
+    @param memoryBytes upper bound of the estimated peak memory of a plan (1 GB by default)
+    */
+    static TrainingBudget calibrated(double memoryBytes = double(1 << 30)){
+        TrainingBudget budget;
+        budget.memoryBytes = memoryBytes;
+
+        const int n = 256;
+        Matrix<float, ColMajor> a(n, n);
+        for(int i = 0; i<n*n; i++){
+            a[i] = float(i % 17) - 8.0f;
+        }
+
+        auto start = chrono::steady_clock::now();
+        auto product = Matrix<float, ColMajor>::multMat(a, a);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(seconds > 0.0){
+            budget.flopsPerCore = 2.0 * n * n * n / seconds / max(budget.cores, 1);
+        }
+
+        //keep the timed product from being optimised away
+        volatile float sink = product[0];
+        (void)sink;
+
+        return budget;
+    }
+};
+
+/*
+@brief estimated cost of one strategy
+@param strategy the strategy
+@param flops floating point operations of the parallel kernels
+@param serialFlops floating point operations that run on one core (Gram-Schmidt of the built-in QR)
+@param bytes peak memory of the matrices the strategy allocates
+@param seconds estimated time on the cores of the budget
+@param fits whether the strategy can run within the budget
+@param reason why the strategy was or was not chosen
+*/
+struct PlanEstimate {
+    TrainingStrategy strategy;
+    double flops = 0.0;
+    double serialFlops = 0.0;
+    double bytes = 0.0;
+    double seconds = 0.0;
+    bool fits = true;
+    string reason;
+};
+
+/*
+@brief the estimates of every strategy and the one that was chosen
+@param estimates one estimate per strategy
+@param chosen index of the cheapest estimate that fits
+*/
+struct TrainingPlan {
+    vector<PlanEstimate> estimates;
+    int chosen = 0;
+
+    const PlanEstimate& best() const {
+        return estimates[chosen];
+    }
+};
+
+/*
+@brief cost of the eigendecomposition of a symmetric n by n matrix, the built-in solver does iterations QR steps of
+8 n^3 operations (Gram-Schmidt, R, R * Q and E * Q) and keeps about 7 n by n matrices alive, the external backend
+reduces to tridiagonal form (about 4 n^3 with the eigenvectors)
+*/
+PlanEstimate eigenCost(double n, int iterations){
+    PlanEstimate cost;
+    if(Backend::active()){
+        cost.flops = 4.0 * n * n * n;
+        cost.bytes = sizeof(float) * 4.0 * n * n;
+    }
+    else{
+        cost.flops = 6.0 * n * n * n * iterations;
+        cost.serialFlops = 2.0 * n * n * n * iterations;
+        cost.bytes = sizeof(float) * 7.0 * n * n;
+    }
+    return cost;
+}
+
+/*
+@brief estimate the operations and the peak memory of every strategy and choose the fastest one that fits the budget
+@param pixels amount of pixels per face
+@param images amount of training faces
+@param k amount of eigenvectors to find
+@param iterations amount of QR iterations of the built-in eigendecomposition
+@param budget memory, cores and parameters of the iterative solver
+@returns TrainingPlan with the estimates and the chosen strategy, throws if no strategy fits
+*/
+TrainingPlan planTraining(int pixels, int images, int k, int iterations, const TrainingBudget& budget){
+    double p = pixels;
+    double n = images;
+    double b = min(k + budget.oversampling, images);
+    double syrk = Backend::active() ? 1.0 : 2.0; //the external backend only computes one triangle
+    double faces = sizeof(float) * p * n;
+
+    TrainingPlan plan;
+
+    //A * A^T, all eigenvectors of it
+    PlanEstimate covariance = eigenCost(p, iterations);
+    covariance.strategy = FullCovariance;
+    covariance.flops += syrk * p * p * n;
+    covariance.bytes += faces + sizeof(float) * (p * p + p * k);
+    plan.estimates.push_back(covariance);
+
+    //A^T * A, its eigenvectors mapped back by A and normalised
+    PlanEstimate gram = eigenCost(n, iterations);
+    gram.strategy = GramMatrix;
+    gram.flops += syrk * n * n * p + 2.0 * p * n * k + 3.0 * p * k;
+    gram.bytes += faces + sizeof(float) * (n * n + n * k + p * k);
+    plan.estimates.push_back(gram);
+
+    //every sweep multiplies with A^T and A and orthonormalises, then a b by b Rayleigh-Ritz problem
+    PlanEstimate iterative = eigenCost(b, budget.ritzIterations);
+    iterative.strategy = IterativeTopK;
+    iterative.flops += budget.sweeps * (4.0 * p * n * b + 2.0 * p * b * b) + 2.0 * p * n * b + 2.0 * n * b * b + 2.0 * p * b * k;
+    if(Backend::active()){
+        iterative.flops += budget.sweeps * 2.0 * p * b * b;
+    }
+    else{
+        iterative.serialFlops += budget.sweeps * 2.0 * p * b * b;
+    }
+    iterative.bytes += faces + sizeof(float) * (3.0 * p * b + n * b + b * b + p * k);
+    plan.estimates.push_back(iterative);
+
+    for(auto& estimate : plan.estimates){
+        double rate = max(budget.flopsPerCore, 1.0);
+        estimate.seconds = estimate.flops / (rate * max(budget.cores, 1)) + estimate.serialFlops / rate;
+
+        stringstream reason;
+        if((estimate.strategy != FullCovariance) && (k > images)){
+            estimate.fits = false;
+            reason << "k is larger than the " << images << " training faces";
+        }
+        else if(k > pixels){
+            estimate.fits = false;
+            reason << "k is larger than the " << pixels << " pixels";
+        }
+        else if(estimate.bytes > budget.memoryBytes){
+            estimate.fits = false;
+            reason << "needs " << fixed << setprecision(1) << estimate.bytes / (1 << 20) << " MB of the "
+                   << budget.memoryBytes / (1 << 20) << " MB budget";
+        }
+        estimate.reason = reason.str();
+    }
+
+    int chosen = -1;
+    for(int i = 0; i<plan.estimates.size(); i++){
+        if(plan.estimates[i].fits && ((chosen < 0) || (plan.estimates[i].seconds < plan.estimates[chosen].seconds))){
+            chosen = i;
+        }
+    }
+    if(chosen < 0){
+        throw runtime_error("no training strategy fits the memory budget");
+    }
+    plan.chosen = chosen;
+
+    for(int i = 0; i<plan.estimates.size(); i++){
+        PlanEstimate& estimate = plan.estimates[i];
+        if(i == chosen){
+            estimate.reason = "fastest estimate within the budget";
+        }
+        else if(estimate.fits){
+            stringstream reason;
+            reason << fixed << setprecision(1) << estimate.seconds / max(plan.best().seconds, 1e-12) << "x slower than "
+                   << strategyName(plan.best().strategy);
+            estimate.reason = reason.str();
+        }
+    }
+
+    return plan;
+}
+
+/*
+@brief print the estimates of a plan as a table
+@param plan the plan returned by planTraining
+*/
+void printPlan(const TrainingPlan& plan, ostream& out = cout){
+    out << "===== Training Plan: " << strategyName(plan.best().strategy) << " =====" << endl;
+    out << setw(12) << "strategy" << setw(12) << "GFLOP" << setw(12) << "MB" << setw(12) << "est. [s]" << "  reason" << endl;
+
+    for(int i = 0; i<plan.estimates.size(); i++){
+        const PlanEstimate& estimate = plan.estimates[i];
+        out << setw(12) << strategyName(estimate.strategy) << fixed << setprecision(2)
+            << setw(12) << (estimate.flops + estimate.serialFlops) * 1e-9 << setw(12) << estimate.bytes / (1 << 20)
+            << setw(12) << estimate.seconds << "  " << (i == plan.chosen ? "* " : "") << estimate.reason << endl;
+    }
+}
+
+/*
+@brief the eigenvectors of a symmetric positive semi-definite matrix sorted by descending eigenvalue
+@param S symmetric matrix (n by n), its diagonal is shifted in place
+@param iterations amount of QR iterations of the built-in eigendecomposition
+@param count amount of eigenvectors to keep
+@returns column-major Matrix (n by count) with the eigenvectors and the eigenvalues
+*/
+tuple<Matrix<float, ColMajor>, vector<float>> leadingEigenvectors(Matrix<float, ColMajor>& S, int iterations, int count){
+    //the built-in Gram-Schmidt loses orthogonality on singular matrices (A^T * A of centered faces always is one), a shift
+    //by the mean eigenvalue keeps the eigenvectors and makes the matrix positive definite
+    float shift = 0.0;
+    if(!Backend::active()){
+        for(int i = 0; i<S.M; i++){
+            shift += S(i, i) / S.M;
+        }
+        for(int i = 0; i<S.M; i++){
+            S(i, i) += shift;
+        }
+    }
+
+    auto decomposition = S.eigen(iterations);
+    auto& E = get<0>(decomposition);
+    auto& e = get<1>(decomposition);
+    for(int i = 0; i<S.M; i++){
+        e[i] -= shift;
+    }
+
+    vector<int> order(S.M);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&e](int a, int b){ return e[a] > e[b]; });
+
+    Matrix<float, ColMajor> vectors(S.M, count);
+    vector<float> values(count);
+    for(int c = 0; c<count; c++){
+        values[c] = e[order[c]];
+        copy(E.data.get() + order[c] * S.M, E.data.get() + (order[c] + 1) * S.M, vectors.data.get() + c * S.M);
+    }
+
+    return make_tuple(vectors, values);
+}
+
+/*
+@brief scale every column to unit length
+@param V column-major matrix whose columns are normalised in place
+*/
+void normalizeColumns(Matrix<float, ColMajor>& V){
+    for(int c = 0; c<V.N; c++){
+        float* v = V.data.get() + c * V.M;
+        float norm = 0.0;
+        for(int i = 0; i<V.M; i++){
+            norm += v[i] * v[i];
+        }
+        norm = sqrt(norm);
+        if(norm > 0.0){
+            for(int i = 0; i<V.M; i++){
+                v[i] /= norm;
+            }
+        }
+    }
+}
+
+/*
+@brief leading eigenvectors of A * A^T from the smaller A^T * A: if A^T * A u = l u then A * A^T (A u) = l (A u)
+@param A the mean centered faces (pixels by images)
+@param k amount of eigenvectors (at most the amount of images)
+@param iterations amount of QR iterations of the built-in eigendecomposition
+@returns column-major Matrix (pixels by k) with the eigenvectors of the k largest eigenvalues
+*/
+Matrix<float, ColMajor> gramEigenvectors(Matrix<float, ColMajor>& A, int k, int iterations){
+    TRACE_SCOPE("gram");
+
+    Matrix<float, ColMajor> G(1, 1);
+    {
+        TRACE_SCOPE("gram matrix");
+        G = Matrix<float, RowMajor>::multTransposed(A.transposedView()).reorder<ColMajor>();
+    }
+
+    Matrix<float, ColMajor> U(1, 1);
+    {
+        TRACE_SCOPE("eigen");
+        U = get<0>(leadingEigenvectors(G, iterations, k));
+    }
+
+    Matrix<float, ColMajor> V = Matrix<float, ColMajor>::multMat(A, U);
+    normalizeColumns(V);
+    return V;
+}
+
+/*
+@brief leading eigenvectors of A * A^T by subspace iteration: a block of k + oversampling vectors is multiplied with
+A * A^T (as A^T and then A, so the covariance is never formed) and orthonormalised for a fixed amount of sweeps, then
+the eigenvectors are taken from the small projected problem (Rayleigh-Ritz)
+@param A the mean centered faces (pixels by images)
+@param k amount of eigenvectors (at most the amount of images)
+@param budget amount of sweeps, oversampling and Rayleigh-Ritz iterations
+@returns column-major Matrix (pixels by k) with the eigenvectors of the k largest eigenvalues
+*/
+Matrix<float, ColMajor> iterativeEigenvectors(Matrix<float, ColMajor>& A, int k, const TrainingBudget& budget){
+    TRACE_SCOPE("iterative");
+
+    int b = min(k + budget.oversampling, A.N);
+
+    //fixed seed so training is reproducible
+    mt19937 generator(17);
+    normal_distribution<float> distribution(0.0, 1.0);
+    Matrix<float, ColMajor> V(A.M, b);
+    for(int i = 0; i<A.M * b; i++){
+        V[i] = distribution(generator);
+    }
+    V = get<0>(V.QRDecomposition());
+
+    for(int sweep = 0; sweep<budget.sweeps; sweep++){
+        TRACE_SCOPE("sweep");
+        Matrix<float, ColMajor> W = Matrix<float, ColMajor>::multMat(A.transposedView(), V);
+        Matrix<float, ColMajor> Y = Matrix<float, ColMajor>::multMat(A, W);
+        V = get<0>(Y.QRDecomposition());
+    }
+
+    //Rayleigh-Ritz: H = V^T * A * A^T * V = W^T * W
+    Matrix<float, ColMajor> W = Matrix<float, ColMajor>::multMat(A.transposedView(), V);
+    Matrix<float, ColMajor> H = Matrix<float, ColMajor>::multMat(W.transposedView(), W);
+    Matrix<float, ColMajor> U = get<0>(leadingEigenvectors(H, budget.ritzIterations, k));
+
+    Matrix<float, ColMajor> result = Matrix<float, ColMajor>::multMat(V, U);
+    normalizeColumns(result);
+    return result;
+}
+
+/*
+@brief leading eigenvectors of A * A^T in descending order until they explain a fraction of the variance. Every block is
+found by a subspace iteration in the complement of the eigenvectors of the earlier blocks, so only the blocks that are
+needed are ever computed. The total variance is the trace of A * A^T, which is the sum of the squares of A
+@param A the mean centered faces (pixels by images)
+@param target fraction of the variance to explain (between 0 and 1)
+@param budget amount of sweeps, oversampling and Rayleigh-Ritz iterations per block
+@param block amount of eigenvectors accepted per block (16 by default)
+@returns column-major Matrix (pixels by k) with the eigenvectors sorted by descending eigenvalue, their eigenvalues and
+the total variance, k is the smallest amount that reaches the target (or the rank of A)
+*/
+tuple<Matrix<float, ColMajor>, vector<float>, double> varianceEigenvectors(Matrix<float, ColMajor>& A, float target,
+                                                                           const TrainingBudget& budget, int block = 16){
+    TRACE_SCOPE("variance");
+
+    if((target <= 0.0) || (target > 1.0)){
+        throw domain_error("the variance target has to be between 0 and 1");
+    }
+
+    double total = 0.0;
+    for(int i = 0; i<A.M * A.N; i++){
+        total += double(A[i]) * A[i];
+    }
+    if(total <= 0.0){
+        throw domain_error("the training faces have no variance");
+    }
+
+    int rank = min(A.M, A.N);
+    vector<float> values;
+    vector<float> columns;
+    double explained = 0.0;
+
+    //fixed seed so training is reproducible
+    mt19937 generator(17);
+    normal_distribution<float> distribution(0.0, 1.0);
+
+    while((explained < target * total) && (values.size() < rank)){
+        TRACE_SCOPE("block");
+        int found = values.size();
+        int keep = min(block, rank - found);
+        int b = min(keep + budget.oversampling, rank - found);
+
+        //remove the directions of the accepted eigenvectors: Y - P * (P^T * Y)
+        Matrix<float, ColMajor> P(A.M, max(found, 1));
+        copy(columns.begin(), columns.end(), P.data.get());
+        auto deflate = [&](Matrix<float, ColMajor>& Y){
+            if(found > 0){
+                Matrix<float, ColMajor> overlap = Matrix<float, ColMajor>::multMat(P.transposedView(), Y);
+                Y -= Matrix<float, ColMajor>::multMat(P, overlap);
+            }
+        };
+
+        Matrix<float, ColMajor> V(A.M, b);
+        for(int i = 0; i<A.M * b; i++){
+            V[i] = distribution(generator);
+        }
+        deflate(V);
+        V = get<0>(V.QRDecomposition());
+
+        for(int sweep = 0; sweep<budget.sweeps; sweep++){
+            Matrix<float, ColMajor> W = Matrix<float, ColMajor>::multMat(A.transposedView(), V);
+            Matrix<float, ColMajor> Y = Matrix<float, ColMajor>::multMat(A, W);
+            deflate(Y);
+            V = get<0>(Y.QRDecomposition());
+        }
+
+        //Rayleigh-Ritz of the block, its leading vectors have converged the most
+        Matrix<float, ColMajor> W = Matrix<float, ColMajor>::multMat(A.transposedView(), V);
+        Matrix<float, ColMajor> H = Matrix<float, ColMajor>::multMat(W.transposedView(), W);
+        auto ritz = leadingEigenvectors(H, budget.ritzIterations, keep);
+        Matrix<float, ColMajor> X = Matrix<float, ColMajor>::multMat(V, get<0>(ritz));
+        normalizeColumns(X);
+
+        for(int c = 0; (c < keep) && (explained < target * total); c++){
+            values.push_back(get<1>(ritz)[c]);
+            columns.insert(columns.end(), X.data.get() + c * A.M, X.data.get() + (c + 1) * A.M);
+            explained += get<1>(ritz)[c];
+        }
+    }
+
+    //a later block can find a larger eigenvalue than an earlier one whose vectors had not fully converged
+    vector<int> order(values.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&values](int a, int b){ return values[a] > values[b]; });
+
+    Matrix<float, ColMajor> vectors(A.M, values.size());
+    vector<float> sorted(values.size());
+    for(int c = 0; c<order.size(); c++){
+        sorted[c] = values[order[c]];
+        copy(columns.begin() + size_t(order[c]) * A.M, columns.begin() + size_t(order[c] + 1) * A.M,
+             vectors.data.get() + size_t(c) * A.M);
+    }
+    return make_tuple(vectors, sorted, total);
+}
+
+/*
+@brief eigenfaces chosen by the fraction of the variance they explain instead of a fixed k
+@param Vk the eigenfaces (pixels by k)
+@param values the eigenvalues of the eigenfaces in descending order
+@param k amount of eigenfaces needed to reach the target
+@param explainedVariance fraction of the variance of the training faces the k eigenfaces explain
+*/
+struct VarianceTraining {
+    Matrix<float> Vk = Matrix<float>(1, 1);
+    vector<float> values;
+    int k = 0;
+    float explainedVariance = 0.0;
+};
+
+/*
+@brief train with as many eigenfaces as are needed to explain a fraction of the variance of the training faces. The
+eigenvectors are found block by block in descending order and the solver stops at the target, so the cost follows the
+amount of eigenfaces that is used. A cached full decomposition of the same faces is used instead if there is one
+@param trainData the training data extracted from the images
+@param target fraction of the variance to explain, e.g. 0.95
+@param budget parameters of the subspace iteration of every block (default budget)
+@param verbose print the chosen k and the explained variance (false by default)
+@param iterations amount of QR iterations the cached decompositions were made with (50000 by default)
+@param cache cache of earlier full decompositions (disabled by default)
+@returns VarianceTraining with the eigenfaces, the chosen k and the explained variance
+*/
+VarianceTraining TrainToVariance(const vector<Image>& trainData, float target, const TrainingBudget& budget=TrainingBudget(),
+                                 bool verbose=false, int iterations=50000, TrainingCache* cache=nullptr){
+    MEMORY_RUN("Train");
+    TRACE_SCOPE("Train");
+
+    if((target <= 0.0) || (target > 1.0)){
+        throw domain_error("the variance target has to be between 0 and 1");
+    }
+
+    VarianceTraining result;
+    TrainingArtifacts artifacts;
+    if(cache){
+        artifacts.key = trainingKey(trainData, iterations);
+    }
+
+    if(cache && cache->lookup(artifacts.key, artifacts)){
+        //the trace is the sum of all eigenvalues of the full decomposition
+        double total = 0.0;
+        for(int i = 0; i<artifacts.values.M; i++){
+            total += max(artifacts.values[i], 0.0f);
+        }
+        if(total <= 0.0){
+            throw domain_error("the training faces have no variance");
+        }
+
+        //the QR iterations do not guarantee the order of the eigenvalues
+        Matrix<float, ColMajor>& e = artifacts.values;
+        vector<int> order(e.M);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&e](int a, int b){ return e[a] > e[b]; });
+
+        double explained = 0.0;
+        while((result.k < e.M) && (explained < target * total)){
+            result.values.push_back(e[order[result.k]]);
+            explained += max(e[order[result.k]], 0.0f);
+            result.k++;
+        }
+        result.explainedVariance = explained / total;
+
+        int pixels = artifacts.basis.M;
+        Matrix<float, ColMajor> leading(pixels, result.k);
+        for(int c = 0; c<result.k; c++){
+            copy(artifacts.basis.data.get() + size_t(order[c]) * pixels, artifacts.basis.data.get() + size_t(order[c] + 1) * pixels,
+                 leading.data.get() + size_t(c) * pixels);
+        }
+        result.Vk = eigenfaces(leading, result.k);
+    }
+    else{
+        Matrix<float> averageFaceVector = meanFace(trainData);
+        Matrix<float, ColMajor> A = faceMatrix(trainData, averageFaceVector);
+        auto decomposition = varianceEigenvectors(A, target, budget);
+
+        result.values = get<1>(decomposition);
+        result.k = result.values.size();
+        double explained = accumulate(result.values.begin(), result.values.end(), 0.0);
+        result.explainedVariance = explained / get<2>(decomposition);
+        result.Vk = eigenfaces(get<0>(decomposition), result.k);
+    }
+
+    if(verbose){
+        cout << "===== " << result.k << " eigenfaces explain " << fixed << setprecision(1) << 100.0 * result.explainedVariance
+             << "% of the variance (target " << 100.0 * target << "%) =====" << endl;
+    }
+
+    return result;
+}
+
+/*
+@brief train with a given strategy
+@param trainData the training data extracted from the images
+@param strategy the way the eigenvectors are found
+@param k amount of eigenvectors to use (default is 100)
+@param budget parameters of the iterative solver (default budget)
+@param verbose print more information about background processes (false by default)
+@param iterations amount of QR iterations for the eigendecomposition (50000 by default)
+@param checkpoint path of a checkpoint of the eigendecomposition, only used by FullCovariance (disabled by default)
+@param cache cache of earlier decompositions, only used by FullCovariance (disabled by default)
+@returns Matrix<float> with the k-highest eigenvectors
+*/
+Matrix<float> TrainWith(const vector<Image>& trainData, TrainingStrategy strategy, int k=100, const TrainingBudget& budget=TrainingBudget(),
+                        bool verbose=false, int iterations=50000, string checkpoint="", TrainingCache* cache=nullptr){
+    if(strategy == FullCovariance){
+        return Train(trainData, k, verbose, iterations, checkpoint, cache);
+    }
+
+    MEMORY_RUN("Train");
+    TRACE_SCOPE("Train");
+    Matrix<float> averageFaceVector = meanFace(trainData);
+    Matrix<float, ColMajor> A = faceMatrix(trainData, averageFaceVector);
+
+    if(verbose){
+        cout << "===== Find the " << k << " leading eigenvectors with the " << strategyName(strategy) << " strategy =====" << endl;
+    }
+
+    Matrix<float, ColMajor> V = (strategy == GramMatrix) ? gramEigenvectors(A, k, iterations) : iterativeEigenvectors(A, k, budget);
+    return eigenfaces(V, k);
+}
+
+/*
+@brief train with the strategy that planTraining estimates to be the fastest within the budget
+@param trainData the training data extracted from the images
+@param k amount of eigenvectors to use (default is 100)
+@param budget memory and cores the training may use (default budget)
+@param verbose print the plan and more information about background processes (false by default)
+@param iterations amount of QR iterations for the eigendecomposition (50000 by default)
+@param checkpoint path of a checkpoint of the eigendecomposition, only used by FullCovariance (disabled by default)
+@param cache cache of earlier decompositions, only used by FullCovariance (disabled by default)
+@returns Matrix<float> with the k-highest eigenvectors
+*/
+Matrix<float> TrainPlanned(const vector<Image>& trainData, int k=100, const TrainingBudget& budget=TrainingBudget(), bool verbose=false,
+                           int iterations=50000, string checkpoint="", TrainingCache* cache=nullptr){
+    int pixels = trainData[0].data->M * trainData[0].data->N;
+    TrainingPlan plan = planTraining(pixels, trainData.size(), k, iterations, budget);
+
+    if(verbose){
+        printPlan(plan);
+    }
+
+    return TrainWith(trainData, plan.best().strategy, k, budget, verbose, iterations, checkpoint, cache);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <chrono>
+
+#include "storage.h"
+
+using namespace std;
+
+/*
+@brief state of the eigen iterations that is passed to a progress callback
+@param iteration amount of finished iterations
+@param iterations total amount of iterations
+@param offDiagonal norm of the off-diagonal elements (goes to 0 on convergence)
+@param eigenvalueDelta largest change of an eigenvalue since the previous report
+@param elapsed seconds since the start of the iterations
+@param values current iterate whose diagonal converges to the eigenvalues, column-major (only valid during the call)
+@param vectors current approximation of the eigenvectors, column-major (only valid during the call)
+*/
+struct EigenProgress {
+  int iteration = 0;
+  int iterations = 0;
+  float offDiagonal = 0.0;
+  float eigenvalueDelta = 0.0;
+  double elapsed = 0.0;
+  const Matrix<float, ColMajor>* values = nullptr;
+  const Matrix<float, ColMajor>* vectors = nullptr;
+};
+
+/*
+@brief callback that is called every few iterations of eigen, returning false stops the iterations early
+*/
+typedef function<bool(const EigenProgress&)> EigenCallback;
+
+/*
+@brief progress bar reporter that redraws at most every minSeconds (and always on the last iteration)
+@param width amount of characters of the bar (default is 50)
+@param minSeconds minimum time between two redraws (default is 0.2)
+@returns EigenCallback that draws the bar and never stops the iterations
+*/
+EigenCallback consoleProgress(int width = 50, double minSeconds = 0.2){
+  auto lastDraw = make_shared<double>(-minSeconds);
+
+  return [width, minSeconds, lastDraw](const EigenProgress& progress){
+    bool last = progress.iteration == progress.iterations;
+    if(!last && (progress.elapsed - *lastDraw < minSeconds)){
+      return true;
+    }
+    *lastDraw = progress.elapsed;
+
+    float fraction = float(progress.iteration) / progress.iterations;
+    int pos = int(width * fraction);
+
+    string bar;
+    for(int j = 0; j<width; j++){
+      if(j < pos){
+        bar += "=";
+      }
+      else if(j == pos){
+        bar += ">";
+      }
+      else{
+        bar += " ";
+      }
+    }
+
+    cout << "\rProgress: [" << bar << "] " << int(fraction * 100.0) << "% off-diagonal norm " << progress.offDiagonal;
+    if(last){
+      cout << endl;
+    }
+    else{
+      cout.flush();
+    }
+
+    return true;
+  };
+}
+
+/*
+@brief call two callbacks one after the other
+@returns EigenCallback that stops the iterations if either of the callbacks does
+*/
+EigenCallback combineCallbacks(const EigenCallback& a, const EigenCallback& b){
+  if(!a){
+    return b;
+  }
+  if(!b){
+    return a;
+  }
+  return [a, b](const EigenProgress& progress){
+    bool continueA = a(progress);
+    bool continueB = b(progress);
+    return continueA && continueB;
+  };
+}
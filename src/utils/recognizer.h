@@ -0,0 +1,571 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <tuple>
+#include <unordered_map>
+#include "matrix.h"
+#include "image.h"
+#include "pca.h"
+#include "face.h"
+#include "ivfpq.h"
+#include "planner.h"
+
+using namespace std;
+
+/*
+@brief a few prototypes per identity in eigenface space, so a search can rank the identities before it compares the probe
+with their individual images
+@param identities names of the identities
+@param prototypes one prototype per row (number of prototypes by k)
+@param owner identity of every prototype
+@param members gallery rows of every identity
+*/
+struct IdentityPrototypes {
+  vector<string> identities;
+  Matrix<float> prototypes = Matrix<float>(1, 1);
+  vector<int> owner;
+  vector<vector<int>> members;
+
+  /*
+  @brief group the gallery by label and summarise every identity by its centroid (perIdentity 1) or by the medoids of an
+  in-class k-means (perIdentity > 1), medoids are gallery faces and stay meaningful for identities with unusual images
+  @param weights projections of the gallery faces (number of faces by k)
+  @param labels names of the gallery faces
+  @param perIdentity amount of prototypes per identity (at most the images of the identity)
+  @param iterations amount of k-means steps for the medoids (10 by default)
+  */
+  static IdentityPrototypes build(const Matrix<float>& weights, const vector<string>& labels, int perIdentity, int iterations = 10){
+    if(perIdentity <= 0){
+      throw domain_error("an identity needs at least one prototype");
+    }
+
+    IdentityPrototypes result;
+    unordered_map<string, int> identityIndex;
+    for(int i = 0; i<labels.size(); i++){
+      auto inserted = identityIndex.insert(make_pair(labels[i], int(result.identities.size())));
+      if(inserted.second){
+        result.identities.push_back(labels[i]);
+        result.members.push_back(vector<int>());
+      }
+      result.members[inserted.first->second].push_back(i);
+    }
+
+    int k = weights.N;
+    vector<float> rows;
+    for(int identity = 0; identity<result.members.size(); identity++){
+      const vector<int>& members = result.members[identity];
+      int clusters = min(perIdentity, int(members.size()));
+
+      Matrix<float> points(members.size(), k);
+      for(int m = 0; m<members.size(); m++){
+        copy(&weights(members[m], 0), &weights(members[m], 0) + k, &points(m, 0));
+      }
+
+      if(clusters == 1){
+        vector<float> centroid(k, 0.0);
+        for(int m = 0; m<members.size(); m++){
+          for(int c = 0; c<k; c++){
+            centroid[c] += points(m, c) / members.size();
+          }
+        }
+        rows.insert(rows.end(), centroid.begin(), centroid.end());
+        result.owner.push_back(identity);
+        continue;
+      }
+
+      //the member closest to every centroid, two centroids can share a medoid
+      Matrix<float> centroids = kmeans(points, clusters, iterations, identity + 1);
+      vector<int> medoids;
+      for(int cluster = 0; cluster<clusters; cluster++){
+        int medoid = nearestCentroid(&centroids(cluster, 0), points);
+        if(find(medoids.begin(), medoids.end(), medoid) == medoids.end()){
+          medoids.push_back(medoid);
+          rows.insert(rows.end(), &points(medoid, 0), &points(medoid, 0) + k);
+          result.owner.push_back(identity);
+        }
+      }
+    }
+
+    result.prototypes = Matrix<float>(result.owner.size(), k);
+    copy(rows.begin(), rows.end(), result.prototypes.data.get());
+    return result;
+  }
+};
+
+/*
+@brief result of recognising one probe
+@param index row of the closest gallery face
+@param label name of the closest gallery face
+@param distance squared distance of the weights
+@param version version of the model that answered
+*/
+struct Recognition {
+  int index;
+  string label;
+  float distance;
+  int version;
+};
+
+/*
+@brief everything needed to recognise a probe, immutable once it is published
+@param mean the average face (pixels by 1)
+@param basis the eigenfaces (pixels by k, column-major so every eigenface is contiguous)
+@param weights projections of the gallery faces (number of faces by k)
+@param labels names of the gallery faces
+@param prototypes prototypes of the identities of the gallery (empty if the model only scans every face)
+@param kernels face kernels of the image geometry
+@param version number of the model, increases with every publish
+@param explainedVariance fraction of the variance of the training faces the eigenfaces explain (0 if unknown)
+*/
+struct RecognitionModel {
+  Matrix<float> mean = Matrix<float>(1, 1);
+  Matrix<float, ColMajor> basis = Matrix<float, ColMajor>(1, 1);
+  Matrix<float> weights = Matrix<float>(1, 1);
+  vector<string> labels;
+  IdentityPrototypes prototypes;
+  FaceKernelTable kernels;
+  int version = 0;
+  float explainedVariance = 0.0;
+
+  /*
+  @brief model of a gallery with the eigenfaces of Train
+  @param gallery the faces to recognise (usually the training faces)
+  @param Vk the eigenfaces returned by Train (pixels by k)
+  @param version number of the model
+  @param perIdentity amount of prototypes per identity (1 by default, 0 for no prototypes)
+  */
+  static unique_ptr<RecognitionModel> build(const vector<Image>& gallery, Matrix<float>& Vk, int version, int perIdentity = 1){
+    unique_ptr<RecognitionModel> model(new RecognitionModel());
+    model->version = version;
+    model->kernels = faceKernels(gallery[0].data->M, gallery[0].data->N);
+    if(model->kernels.pixels != Vk.M){
+      throw domain_error("Matrix dimensions do not match");
+    }
+
+    model->mean = meanFace(gallery);
+    model->basis = Vk.reorder<ColMajor>();
+    Matrix<float, ColMajor> A = faceMatrix(gallery, model->mean);
+    model->weights = Matrix<float>::multMat(A.transposedView(), model->basis);
+    for(const auto& image : gallery){
+      model->labels.push_back(image.getName());
+    }
+    if(perIdentity > 0){
+      model->prototypes = IdentityPrototypes::build(model->weights, model->labels, perIdentity);
+    }
+    return model;
+  }
+
+  /*
+  @brief model of a gallery with the eigenfaces of TrainToVariance, k and the explained variance are kept with the model
+  @param gallery the faces to recognise (usually the training faces)
+  @param training the result of TrainToVariance
+  @param version number of the model
+  @param perIdentity amount of prototypes per identity (1 by default, 0 for no prototypes)
+  */
+  static unique_ptr<RecognitionModel> build(const vector<Image>& gallery, VarianceTraining& training, int version, int perIdentity = 1){
+    auto model = build(gallery, training.Vk, version, perIdentity);
+    model->explainedVariance = training.explainedVariance;
+    return model;
+  }
+
+  /*
+  @brief project a probe onto the eigenfaces
+  @param probe face with the geometry of the model
+  @returns vector<float> with the k weights of the probe
+  */
+  vector<float> project(const Image& probe) const {
+    if((probe.data->M != kernels.rows) || (probe.data->N != kernels.cols)){
+      throw domain_error("Matrix dimensions do not match");
+    }
+
+    vector<float> centered(kernels.pixels);
+    vector<float> w(basis.N);
+    kernels.center(probe.data->data.get(), mean.data.get(), centered.data(), kernels.pixels);
+    kernels.project(centered.data(), basis.data.get(), basis.N, w.data(), kernels.pixels);
+    return w;
+  }
+
+  /*
+  @brief project 8-bit probes onto the eigenfaces in one fused pass, without float copies of the probes
+  @param faces the pooled pixels of every probe (row-major, with the geometry of the model)
+  @returns Matrix (number of probes by k) with the weights of the probes
+  */
+  Matrix<float> projectBytes(const vector<const uint8_t*>& faces) const {
+    Matrix<float> w(max(int(faces.size()), 1), basis.N);
+    kernels.projectBytes(faces.data(), faces.size(), mean.data.get(), basis.data.get(), basis.N, w.data.get(), kernels.pixels);
+    return w;
+  }
+
+  /*
+  @brief closest gallery face of projected weights. With a shortlist the identities are ranked by their closest prototype
+  first and only the images of the shortlist identities are compared
+  @param w the k weights of the probe
+  @param shortlist amount of identities whose images are compared (every image without prototypes or if <= 0)
+  @returns the closest face among the compared ones
+  */
+  Recognition search(const float* w, int shortlist = 0) const {
+    int k = weights.N;
+    Recognition result = {-1, "", numeric_limits<float>::max(), version};
+    auto compare = [&](int j){
+      float distance = squaredDistance(w, &weights(j, 0), k);
+      if(distance < result.distance){
+        result.distance = distance;
+        result.index = j;
+      }
+    };
+
+    int identities = prototypes.identities.size();
+    if((shortlist <= 0) || (shortlist >= identities)){
+      for(int j = 0; j<weights.M; j++){
+        compare(j);
+      }
+    }
+    else{
+      vector<pair<float, int>> ranking(identities, make_pair(numeric_limits<float>::max(), 0));
+      for(int identity = 0; identity<identities; identity++){
+        ranking[identity].second = identity;
+      }
+      for(int p = 0; p<prototypes.owner.size(); p++){
+        auto& rank = ranking[prototypes.owner[p]];
+        rank.first = min(rank.first, squaredDistance(w, &prototypes.prototypes(p, 0), k));
+      }
+
+      partial_sort(ranking.begin(), ranking.begin() + shortlist, ranking.end());
+      for(int i = 0; i<shortlist; i++){
+        for(int j : prototypes.members[ranking[i].second]){
+          compare(j);
+        }
+      }
+    }
+
+    result.label = (result.index >= 0) ? labels[result.index] : "";
+    return result;
+  }
+};
+
+/*
+@brief epoch based reclamation. A reader announces the global epoch in a free slot before it reads a shared pointer
+and clears the slot when it is done. Retired objects are tagged with the epoch of their retirement, and an object can be
+freed once every slot is empty or announces a later epoch, because such readers started after the object was unlinked.
+Readers only use atomic loads, stores and a compare-exchange to claim a slot, they never wait for a writer
+@param Slots amount of readers that can be active at the same time without searching for a free slot
+*/
+struct EpochDomain {
+  static const int Slots = 64;
+
+  atomic<uint64_t> epoch;
+  atomic<uint64_t> slots[Slots];
+  atomic<int> pending;
+
+  mutex retiredMutex; //taken by writers, readers only try it
+  vector<pair<uint64_t, function<void()>>> retired;
+  atomic<int> reclaimed;
+
+  EpochDomain() : epoch(1), pending(0), reclaimed(0) {
+    for(auto& slot : slots){
+      slot.store(0);
+    }
+  }
+
+  ~EpochDomain(){
+    //nobody can read anymore
+    for(auto& item : retired){
+      item.second();
+    }
+  }
+
+  /*
+  @brief announcement of one reader, the shared pointers read while it exists stay valid
+  */
+  struct Guard {
+    EpochDomain& domain;
+    int slot;
+
+    Guard(EpochDomain& domain) : domain(domain) {
+      //threads start looking at different slots so they rarely meet
+      static atomic<int> next(0);
+      thread_local int preferred = next++;
+
+      for(int attempt = 0; ; attempt++){
+        slot = (preferred + attempt) % Slots;
+        uint64_t free = 0;
+        if(domain.slots[slot].compare_exchange_strong(free, domain.epoch.load())){
+          break;
+        }
+        if(attempt % Slots == Slots - 1){
+          this_thread::yield();
+        }
+      }
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    ~Guard(){
+      domain.slots[slot].store(0);
+
+      //the last reader of a retired object frees it, unless a writer is already doing that
+      if(domain.pending.load() > 0){
+        domain.collect(false);
+      }
+    }
+  };
+
+  /*
+  @brief hand an object that was unlinked from every shared pointer to the domain
+  @param free frees the object once no reader can hold it anymore
+  */
+  void retire(function<void()> free){
+    {
+      lock_guard<mutex> lock(retiredMutex);
+      retired.push_back(make_pair(epoch.fetch_add(1), free));
+      pending.store(retired.size());
+    }
+    collect(true);
+  }
+
+  /*
+  @brief free the retired objects that no reader can hold anymore
+  @param wait wait for the list of retired objects (writers) or give up if another thread has it (readers)
+  @returns amount of objects that are still retired
+  */
+  int collect(bool wait = true){
+    unique_lock<mutex> lock(retiredMutex, defer_lock);
+    if(wait){
+      lock.lock();
+    }
+    else if(!lock.try_lock()){
+      return pending.load();
+    }
+
+    uint64_t oldest = numeric_limits<uint64_t>::max();
+    for(auto& slot : slots){
+      uint64_t announced = slot.load();
+      if(announced != 0){
+        oldest = min(oldest, announced);
+      }
+    }
+
+    vector<function<void()>> ready;
+    vector<pair<uint64_t, function<void()>>> waiting;
+    for(auto& item : retired){
+      if(item.first < oldest){
+        ready.push_back(item.second);
+      }
+      else{
+        waiting.push_back(item);
+      }
+    }
+    retired.swap(waiting);
+    pending.store(retired.size());
+    lock.unlock();
+
+    for(auto& free : ready){
+      free();
+    }
+    reclaimed += ready.size();
+    return pending.load();
+  }
+};
+
+/*
+@brief recognises probes with a model that can be replaced while queries are running. Queries read the current model
+through an atomic pointer inside an epoch guard, so they never take a lock and never see a model that is freed under
+them. publish() swaps in a new model in one atomic exchange, queries that started before keep using the old one and
+the old model is freed when the last of them leaves
+@param model the first model
+*/
+struct Recognizer {
+  EpochDomain domain;
+  atomic<const RecognitionModel*> current;
+
+  Recognizer(unique_ptr<RecognitionModel> model) : current(model.release()) {
+    if(!current.load()){
+      throw domain_error("a recognizer needs a model");
+    }
+  }
+
+  Recognizer(const Recognizer&) = delete;
+  Recognizer& operator=(const Recognizer&) = delete;
+
+  ~Recognizer(){
+    delete current.load();
+  }
+
+  /*
+  @brief replace the model, returns without waiting for the queries that still use the old one
+  @param model the new model
+  */
+  void publish(unique_ptr<RecognitionModel> model){
+    if(!model){
+      throw domain_error("a recognizer needs a model");
+    }
+    const RecognitionModel* old = current.exchange(model.release());
+    domain.retire([old](){ delete old; });
+  }
+
+  /*
+  @brief version of the current model
+  */
+  int version(){
+    EpochDomain::Guard guard(domain);
+    return current.load()->version;
+  }
+
+  /*
+  @brief find the closest gallery face of a probe
+  @param probe face with the geometry of the model
+  @param shortlist amount of identities whose images are compared after ranking the prototypes (every image if <= 0)
+  @returns the closest face and the version of the model that was used
+  */
+  Recognition recognize(const Image& probe, int shortlist = 0){
+    EpochDomain::Guard guard(domain);
+    const RecognitionModel& model = *current.load();
+
+    vector<float> w = model.project(probe);
+    return model.search(w.data(), shortlist);
+  }
+
+  /*
+  @brief find the closest gallery faces of a batch of 8-bit probes (see Image::decodePooled), the probes share every
+  block of the eigenfaces that is read while they are projected
+  @param faces the pooled pixels of every probe (row-major, with the geometry of the model)
+  @param shortlist amount of identities whose images are compared after ranking the prototypes (every image if <= 0)
+  @returns one Recognition per probe, all from the same model
+  */
+  vector<Recognition> recognizeBytes(const vector<const uint8_t*>& faces, int shortlist = 0){
+    EpochDomain::Guard guard(domain);
+    const RecognitionModel& model = *current.load();
+
+    Matrix<float> w = model.projectBytes(faces);
+    vector<Recognition> results;
+    for(int i = 0; i<faces.size(); i++){
+      results.push_back(model.search(&w(i, 0), shortlist));
+    }
+    return results;
+  }
+};
+
+/*
+@brief accuracy and matching time of one search configuration
+@param perIdentity amount of prototypes per identity (0 for the exact scan of every image)
+@param shortlist amount of identities whose images are compared (0 for the exact scan)
+@param accuracy fraction of correctly recognised test faces
+@param agreement fraction of test faces matched to the same image as the exact scan
+@param compared average amount of distances computed per probe (prototypes and images)
+@param matchMicros average time to match the weights of a single probe
+*/
+struct PrototypeResult {
+  int perIdentity;
+  int shortlist;
+  float accuracy;
+  float agreement;
+  double compared;
+  double matchMicros;
+};
+
+/*
+@brief compare the two-stage search over identity prototypes with the exact scan of every training image. The probes are
+projected once, only the matching is timed
+@param split amount of the images to be used as training data
+@param k amount of eigenfaces
+@param perIdentity candidate amounts of prototypes per identity
+@param shortlists candidate amounts of identities whose images are compared
+@param iterations amount of QR iterations for the eigendecomposition (50000 by default)
+@param cache cache of earlier decompositions (disabled by default)
+@returns vector<PrototypeResult> with the exact scan first and one entry per (perIdentity, shortlist)
+*/
+vector<PrototypeResult> evaluatePrototypes(float split, int k, const vector<int>& perIdentity, const vector<int>& shortlists,
+                                           int iterations = 50000, TrainingCache* cache = nullptr){
+  auto data = splitData(loadImages(2), split);
+  auto trainData = get<0>(data);
+  auto testData = get<1>(data);
+  auto Vk = TrainPlanned(trainData, k, TrainingBudget(), false, iterations, "", cache);
+
+  auto model = RecognitionModel::build(trainData, Vk, 0, 0);
+  vector<vector<float>> probes;
+  for(const auto& probe : testData){
+    probes.push_back(model->project(probe));
+  }
+
+  vector<int> exact;
+  //a single pass over the test set takes microseconds, it is repeated to get a stable time
+  const int repeats = 20;
+  auto measure = [&](const RecognitionModel& model, int prototypes, int shortlist){
+    vector<int> matches;
+    auto start = chrono::steady_clock::now();
+    for(int repeat = 0; repeat<repeats; repeat++){
+      matches.clear();
+      for(const auto& w : probes){
+        matches.push_back(model.search(w.data(), shortlist).index);
+      }
+    }
+    double elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repeats;
+    if(exact.empty()){
+      exact = matches;
+    }
+
+    int correct = 0;
+    int agreeing = 0;
+    double compared = 0.0;
+    for(int t = 0; t<probes.size(); t++){
+      correct += (model.labels[matches[t]] == testData[t].getName());
+      agreeing += (matches[t] == exact[t]);
+    }
+    if(shortlist > 0){
+      //the images of an identity are all compared, so the shortlist of a probe costs the sizes of its identities
+      for(int t = 0; t<probes.size(); t++){
+        compared += model.prototypes.owner.size();
+        compared += double(model.weights.M) * shortlist / model.prototypes.identities.size();
+      }
+    }
+    else{
+      compared = double(model.weights.M) * probes.size();
+    }
+
+    int count = max(int(probes.size()), 1);
+    PrototypeResult result = {prototypes, shortlist, float(correct) / count, float(agreeing) / count, compared / count,
+                              elapsed / count};
+    return result;
+  };
+
+  vector<PrototypeResult> results;
+  results.push_back(measure(*model, 0, 0));
+  for(int prototypes : perIdentity){
+    model->prototypes = IdentityPrototypes::build(model->weights, model->labels, prototypes);
+    for(int shortlist : shortlists){
+      results.push_back(measure(*model, prototypes, shortlist));
+    }
+  }
+
+  return results;
+}
+
+/*
+@brief print the results of evaluatePrototypes as a table
+@param results the results returned by evaluatePrototypes
+*/
+void printPrototypes(const vector<PrototypeResult>& results){
+  cout << "===== Prototype Search Results =====" << endl;
+  cout << setw(12) << "prototypes" << setw(12) << "shortlist" << setw(12) << "accuracy" << setw(12) << "agreement"
+       << setw(12) << "compared" << setw(14) << "match [us]" << endl;
+
+  for(const auto& result : results){
+    cout << setw(12) << (result.perIdentity > 0 ? to_string(result.perIdentity) : "exact")
+         << setw(12) << (result.shortlist > 0 ? to_string(result.shortlist) : "-") << fixed << setprecision(2)
+         << setw(12) << result.accuracy << setw(12) << result.agreement << setw(12) << result.compared
+         << setw(14) << result.matchMicros << endl;
+  }
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <chrono>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "matrix.h"
+#include "image.h"
+#include "face.h"
+#include "trace.h"
+
+using namespace std;
+
+/*
+@brief mean face and covariance of a dataset computed by several processes
+@param mean the average face (pixels by 1)
+@param covariance sum over all faces of (face - mean) * (face - mean)^T (pixels by pixels)
+@param count amount of faces
+*/
+struct ShardedCovariance {
+    Matrix<float> mean = Matrix<float>(1, 1);
+    Matrix<float, ColMajor> covariance = Matrix<float, ColMajor>(1, 1);
+    int count = 0;
+};
+
+/*
+@brief POSIX shared memory segment that is mapped before forking, so every worker process sees the same memory. The
+name is unlinked right after mapping, the segment disappears with the last process that has it mapped
+@param bytes size of the segment
+*/
+struct SharedSegment {
+    void* memory = nullptr;
+    size_t bytes = 0;
+
+    SharedSegment(size_t bytes) : bytes(bytes) {
+        static atomic<int> counter(0);
+        string name = "/eigenfaces-" + to_string(getpid()) + "-" + to_string(counter++);
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(fd < 0){
+            throw runtime_error("could not create shared memory " + name);
+        }
+        shm_unlink(name.c_str());
+
+        if(ftruncate(fd, bytes) != 0){
+            close(fd);
+            throw runtime_error("could not resize shared memory " + name);
+        }
+
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(memory == MAP_FAILED){
+            memory = nullptr;
+            throw runtime_error("could not map shared memory " + name);
+        }
+    }
+
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+
+    ~SharedSegment(){
+        if(memory){
+            munmap(memory, bytes);
+        }
+    }
+};
+
+/*
+@brief compute the mean face and covariance of the images with several worker processes. Every worker decodes its own
+contiguous slice of the paths, so the decoded images only live in its address space, and writes the sum of its faces
+and the partial product X * X^T of its slice into its block of a shared memory segment. The blocks are then added in
+a binary tree: in round r the worker w (a multiple of 2^(r+1)) adds the block of worker w + 2^r as soon as that worker
+has finished, so the reduction runs in parallel and block 0 ends up with the total.
+The faces are shifted by the first image before the products are formed, which keeps the values small so that
+covariance = S - n * m * m^T (S and m of the shifted faces) does not lose precision to cancellation
+@param paths paths of the images
+@param poolingFactor to compress the image
+@param workers amount of worker processes (at most one per image)
+@returns the mean face and the covariance of all images
+*/
+ShardedCovariance shardedCovariance(const vector<string>& paths, int poolingFactor, int workers){
+    TRACE_SCOPE("sharded covariance");
+
+    if(paths.empty()){
+        throw domain_error("no images to train on");
+    }
+    workers = max(1, min(workers, int(paths.size())));
+
+    //the first image is decoded here for the geometry and as the shift of the faces
+    Image reference(paths[0].c_str(), poolingFactor);
+    int rows = reference.data->M;
+    int cols = reference.data->N;
+    int pixels = rows * cols;
+    auto kernels = faceKernels(rows, cols);
+
+    //header with one flag per worker, then one block (sum of the faces, then the column-major product) per worker
+    size_t header = ((sizeof(atomic<int>) * workers + sizeof(double) - 1) / sizeof(double)) * sizeof(double);
+    size_t block = size_t(pixels) + size_t(pixels) * pixels;
+    SharedSegment segment(header + sizeof(double) * block * workers);
+
+    atomic<int>* finished = reinterpret_cast<atomic<int>*>(segment.memory);
+    for(int w = 0; w<workers; w++){
+        new (&finished[w]) atomic<int>(0);
+    }
+    double* blocks = reinterpret_cast<double*>(static_cast<char*>(segment.memory) + header);
+
+    auto work = [&](int w){
+        //the thread pool of the parent does not exist in the child, every loop runs serially in this process
+        ThreadPool::isWorker() = true;
+
+        int begin = int(paths.size() * size_t(w) / workers);
+        int end = int(paths.size() * size_t(w + 1) / workers);
+
+        Matrix<float, ColMajor> X(pixels, end - begin);
+        for(int i = begin; i<end; i++){
+            Image image(paths[i].c_str(), poolingFactor);
+            if((image.data->M != rows) || (image.data->N != cols)){
+                throw domain_error("Matrix dimensions do not match");
+            }
+            kernels.center(image.data->data.get(), reference.data->data.get(), X.data.get() + (i - begin) * pixels, pixels);
+        }
+
+        double* sum = blocks + block * w;
+        double* product = sum + pixels;
+        for(int j = 0; j<X.N; j++){
+            for(int p = 0; p<pixels; p++){
+                sum[p] += X[j * pixels + p];
+            }
+        }
+
+        auto partial = Matrix<float, ColMajor>::multTransposed(X);
+        for(size_t i = 0; i<size_t(pixels) * pixels; i++){
+            product[i] = partial[i];
+        }
+
+        //tree reduction, a worker stops once its block has been handed to its partner
+        for(int stride = 1; stride<workers; stride *= 2){
+            if(w % (2 * stride) != 0){
+                break;
+            }
+            int partner = w + stride;
+            if(partner >= workers){
+                continue;
+            }
+
+            while(finished[partner].load(memory_order_acquire) == 0){
+                sched_yield();
+            }
+
+            const double* other = blocks + block * partner;
+            for(size_t i = 0; i<block; i++){
+                sum[i] += other[i];
+            }
+        }
+
+        finished[w].store(1, memory_order_release);
+    };
+
+    vector<pid_t> children;
+    for(int w = 0; w<workers; w++){
+        pid_t pid = fork();
+        if(pid < 0){
+            for(pid_t child : children){
+                kill(child, SIGKILL);
+                waitpid(child, nullptr, 0);
+            }
+            throw runtime_error("could not start worker process");
+        }
+
+        if(pid == 0){
+            int status = 0;
+            try{
+                work(w);
+            }
+            catch(const exception& error){
+                cerr << "worker " << w << ": " << error.what() << endl;
+                status = 1;
+            }
+            catch(...){
+                status = 1;
+            }
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+
+    //a failed worker never finishes its block, so the others are stopped instead of waiting for it forever. Only the
+    //workers are reaped, other children of the program keep their exit status for whoever owns them
+    bool failed = false;
+    vector<bool> running(workers, true);
+    for(int remaining = workers; remaining > 0;){
+        bool reaped = false;
+        for(int w = 0; w<workers; w++){
+            if(!running[w]){
+                continue;
+            }
+
+            int status = 0;
+            pid_t pid = waitpid(children[w], &status, WNOHANG);
+            if(pid == 0){
+                continue;
+            }
+            if(pid < 0){
+                throw runtime_error("lost track of the worker processes");
+            }
+
+            running[w] = false;
+            reaped = true;
+            remaining--;
+
+            if(!failed && (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))){
+                failed = true;
+                for(int other = 0; other<workers; other++){
+                    if(running[other]){
+                        kill(children[other], SIGKILL);
+                    }
+                }
+            }
+        }
+
+        if(!reaped && (remaining > 0)){
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    if(failed){
+        throw runtime_error("a worker process failed to compute its covariance block");
+    }
+
+    //covariance = S - n * m * m^T with the mean m of the shifted faces, the mean face is m plus the shift
+    ShardedCovariance result;
+    result.count = paths.size();
+    result.mean = Matrix<float>(pixels, 1);
+    result.covariance = Matrix<float, ColMajor>(pixels, pixels);
+
+    const double* sum = blocks;
+    const double* product = blocks + pixels;
+    double n = result.count;
+    float* C = result.covariance.data.get();
+
+    parallelFor(pixels, pixels, [&](int begin, int end){
+        for(int j = begin; j<end; j++){
+            for(int i = 0; i<pixels; i++){
+                C[i + j * pixels] = float(product[i + size_t(j) * pixels] - sum[i] * sum[j] / n);
+            }
+        }
+    });
+
+    for(int p = 0; p<pixels; p++){
+        result.mean[p] = float(sum[p] / n) + reference.data->operator[](p);
+    }
+
+    return result;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+/*
+@brief memory layout of a Matrix. RowMajor stores the rows one after another (element (i,j) at i*N + j), ColMajor stores
+the columns one after another (element (i,j) at j*M + i)
+*/
+enum StorageOrder { RowMajor, ColMajor };
+
+template<typename T, StorageOrder Order = RowMajor>
+struct Matrix;
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "memprofile.h"
+
+using namespace std;
+
+/*
+Tracing is only compiled in when TRACE is defined (cmake -DTRACE=ON). Without it all macros expand to nothing.
+
+TRACE_SCOPE(name)            records a span from this line to the end of the enclosing scope (and is a MEMORY_PHASE)
+TRACE_COUNTER(name, value)   records the value of a counter (e.g. a convergence residual)
+TRACE_FLOPS(n)               adds n floating point operations to the current thread
+TRACE_BYTES(n)               adds n allocated bytes to the current thread
+TRACE_WRITE(path)            writes all recorded events as Chrome trace JSON (chrome://tracing or ui.perfetto.dev)
+*/
+#ifdef TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_COUNTER(name, value) Tracer::counter(name, value)
+#define TRACE_FLOPS(n) Tracer::buffer().flops += (n)
+#define TRACE_BYTES(n) Tracer::buffer().bytes += (n)
+#define TRACE_WRITE(path) Tracer::write(path)
+#else
+#define TRACE_SCOPE(name) MEMORY_PHASE(name)
+#define TRACE_COUNTER(name, value)
+#define TRACE_FLOPS(n)
+#define TRACE_BYTES(n)
+#define TRACE_WRITE(path)
+#endif
+
+/*
+@brief a single span ('X') or counter ('C') event, times are in nanoseconds since the start of the program
+*/
+struct TraceEvent {
+    const char* name;
+    char phase;
+    uint64_t start;
+    uint64_t duration;
+    double value;
+    uint64_t flops;
+    uint64_t bytes;
+};
+
+/*
+@brief fixed size block of events, only the owning thread writes to it
+*/
+struct TraceChunk {
+    static const int capacity = 4096;
+    TraceEvent events[capacity];
+    atomic<int> count;
+    atomic<TraceChunk*> next;
+
+    TraceChunk() : count(0), next(nullptr) {}
+};
+
+/*
+@brief events and running totals of one thread. Appending is lock free, a new chunk is linked in when the last one is full
+*/
+struct TraceBuffer {
+    int tid;
+    TraceChunk* first;
+    TraceChunk* last;
+    uint64_t flops = 0;
+    uint64_t bytes = 0;
+
+    TraceBuffer(int tid) : tid(tid) {
+        first = new TraceChunk();
+        last = first;
+    }
+
+    void append(const TraceEvent& event){
+        int count = last->count.load(memory_order_relaxed);
+        if(count == TraceChunk::capacity){
+            auto chunk = new TraceChunk();
+            last->next.store(chunk, memory_order_release);
+            last = chunk;
+            count = 0;
+        }
+        last->events[count] = event;
+        last->count.store(count + 1, memory_order_release);
+    }
+};
+
+struct Tracer {
+
+    /*
+    @brief nanoseconds since the first call
+    */
+    static uint64_t now(){
+        static const auto epoch = chrono::steady_clock::now();
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+    }
+
+    static mutex& registryMutex(){
+        static mutex m;
+        return m;
+    }
+
+    static vector<TraceBuffer*>& registry(){
+        static vector<TraceBuffer*> buffers;
+        return buffers;
+    }
+
+    /*
+    @brief buffer of the calling thread, registered once on first use (buffers live until the program exits)
+    */
+    static TraceBuffer& buffer(){
+        thread_local TraceBuffer* local = nullptr;
+        if(!local){
+            lock_guard<mutex> lock(registryMutex());
+            local = new TraceBuffer(registry().size());
+            registry().push_back(local);
+        }
+        return *local;
+    }
+
+    /*
+    @brief record the current value of a counter
+    */
+    static void counter(const char* name, double value){
+        TraceEvent event = {name, 'C', now(), 0, value, 0, 0};
+        buffer().append(event);
+    }
+
+    /*
+    @brief write every recorded event in the Chrome trace event format
+    @param path path of the JSON file
+    */
+    static void write(const string& path){
+        lock_guard<mutex> lock(registryMutex());
+        ofstream out(path);
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        out.precision(3);
+        out << fixed;
+
+        bool firstEvent = true;
+        for(auto buffer : registry()){
+            for(auto chunk = buffer->first; chunk; chunk = chunk->next.load(memory_order_acquire)){
+                int count = chunk->count.load(memory_order_acquire);
+
+                for(int i = 0; i<count; i++){
+                    const TraceEvent& e = chunk->events[i];
+                    out << (firstEvent ? "" : ",\n");
+                    firstEvent = false;
+
+                    out << "{\"name\": \"" << e.name << "\", \"ph\": \"" << e.phase << "\", \"pid\": 1, \"tid\": " << buffer->tid
+                        << ", \"ts\": " << e.start / 1000.0;
+
+                    if(e.phase == 'X'){
+                        out << ", \"dur\": " << e.duration / 1000.0
+                            << ", \"args\": {\"flops\": " << e.flops << ", \"bytes allocated\": " << e.bytes << "}}";
+                    }
+                    else{
+                        out << ", \"args\": {\"value\": " << e.value << "}}";
+                    }
+                }
+            }
+        }
+
+        out << "\n]}\n";
+    }
+};
+
+/*
+@brief records a span from construction until destruction together with the flops and bytes of the thread in between
+*/
+struct TraceScope {
+    const char* name;
+    uint64_t start;
+    uint64_t flops;
+    uint64_t bytes;
+#ifdef MEMPROFILE
+    MemoryPhase phase;
+#endif
+
+#ifdef MEMPROFILE
+    TraceScope(const char* name) : name(name), phase(name) {
+#else
+    TraceScope(const char* name) : name(name) {
+#endif
+        TraceBuffer& buffer = Tracer::buffer();
+        flops = buffer.flops;
+        bytes = buffer.bytes;
+        start = Tracer::now();
+    }
+
+    ~TraceScope(){
+        uint64_t end = Tracer::now();
+        TraceBuffer& buffer = Tracer::buffer();
+        TraceEvent event = {name, 'X', start, end - start, 0.0, buffer.flops - flops, buffer.bytes - bytes};
+        buffer.append(event);
+    }
+};